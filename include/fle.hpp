@@ -4,6 +4,7 @@
 #define FLE_HPP
 
 #include "nlohmann/json.hpp"
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <map>
@@ -18,9 +19,26 @@ enum class RelocationType {
     R_X86_64_PC32, // 32-bit PC-relative addressing
     R_X86_64_64, // 64-bit absolute addressing
     R_X86_64_32S, // 32-bit signed absolute addressing
-    R_X86_64_GOTPCREL // 32-bit PC-relative GOT address
+    R_X86_64_GOTPCREL, // 32-bit PC-relative GOT address
+    R_X86_64_TPOFF32, // 32-bit offset from the thread pointer (local-exec TLS)
+    R_X86_64_GOTTPOFF, // 32-bit PC-relative GOT entry holding a TP offset (initial-exec TLS)
+    R_X86_64_COPY // Dynamic only: copy a shared library's data symbol into the executable
 };
 
+// Bytes a relocation patches; an R_X86_64_COPY marker covers the symbol's whole size
+// and stands in front of its data instead of replacing part of it
+inline size_t relocation_size(RelocationType type)
+{
+    switch (type) {
+    case RelocationType::R_X86_64_64:
+        return 8;
+    case RelocationType::R_X86_64_COPY:
+        return 0;
+    default:
+        return 4;
+    }
+}
+
 // Relocation entry
 struct Relocation {
     RelocationType type;
@@ -48,9 +66,11 @@ struct Symbol {
 
 struct FLESection {
     std::string name;
-    std::vector<uint8_t> data; // Section data (stored as bytes)
+    std::vector<uint8_t> data; // Section data (stored as bytes); empty for NOBITS sections
     std::vector<Relocation> relocs; // Relocation table for this section
     bool has_symbols; // Whether section contains symbols
+    size_t size = 0; // Size in memory; equals data.size() unless nobits is set
+    bool nobits = false; // Zero-initialized (like .bss): has a size but no stored bytes
 };
 
 enum class PHF { // Program Header Flags
@@ -64,6 +84,7 @@ enum class SHF { // Section Header Flags
     WRITE = 2, // Writable
     EXEC = 4, // Executable
     NOBITS = 8, // Takes no space in file (like BSS)
+    TLS = 16, // Thread-local storage template (.tdata/.tbss)
 };
 
 // ================= PHF (Program Header Flags) =================
@@ -138,6 +159,7 @@ struct SectionHeader {
     uint64_t addr; // Virtual address
     uint64_t offset; // File offset
     uint64_t size; // Section size
+    uint64_t align = 1; // Required alignment; written only when above 1
 };
 
 struct ProgramHeader {
@@ -147,18 +169,72 @@ struct ProgramHeader {
     uint32_t flags; // Permissions
 };
 
+// One function or object of a linked image
+struct SymbolIndexEntry {
+    uint64_t start; // Virtual address (relative to the load base for .so)
+    uint64_t size; // Bytes covered; 0 if unknown
+    uint32_t name; // Index into SymbolIndex::names
+};
+
+/**
+ * Address-sorted index of the function and object symbols of a linked image
+ *
+ * FLE_ld writes it into every .exe and .so, so tools can map an address
+ * back to a symbol with a binary search instead of scanning every symbol.
+ * Labels, undefined and thread-local symbols are left out.
+ */
+struct SymbolIndex {
+    std::vector<SymbolIndexEntry> entries; // Sorted by start, then by name
+    std::vector<std::string> names;
+
+    /**
+     * Find the symbol covering addr
+     * @return The last entry starting at or below addr whose size covers it
+     *         (a zero-size entry only covers its own start), or nullptr
+     */
+    const SymbolIndexEntry* lookup(uint64_t addr) const
+    {
+        size_t lo = 0;
+        size_t hi = entries.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (entries[mid].start <= addr) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        // Aliases share a start address; any of them that covers addr will do
+        for (size_t i = lo; i-- > 0 && entries[i].start == entries[lo - 1].start;) {
+            if (addr - entries[i].start < std::max<uint64_t>(entries[i].size, 1)) {
+                return &entries[i];
+            }
+        }
+        return nullptr;
+    }
+};
+
+// Where a bundle pre-binds an import: the defining member and its section offset
+struct BundleBinding {
+    size_t member; // Index into the bundle's members, i.e. its load order
+    std::string section;
+    uint64_t offset;
+};
+
 struct FLEObject {
     std::string name; // Object name
-    std::string type; // ".obj", ".exe", ".ar" or ".so"
+    std::string type; // ".obj", ".exe", ".ar", ".so" or ".bundle"
     std::map<std::string, FLESection> sections; // Section name -> section data
     std::vector<Symbol> symbols; // Global symbol table
     std::vector<ProgramHeader> phdrs; // Program headers (for .exe)
     std::vector<SectionHeader> shdrs; // Section headers
-    std::vector<FLEObject> members; // Members of archive
+    std::vector<FLEObject> members; // Members of archive, or of bundle in load order
     size_t entry = 0; // Entry point (for .exe)
 
     std::vector<std::string> needed; // List of shared libraries this object depends on (e.g., "libfoo.so")
     std::vector<Relocation> dyn_relocs; // Dynamic relocations
+    SymbolIndex symbol_index; // Address-sorted symbols (for .exe and .so)
+    std::map<std::string, BundleBinding> bindings; // Pre-bound imports (for .bundle)
 };
 
 class FLEWriter {
@@ -180,6 +256,12 @@ public:
         current_lines.clear();
     }
 
+    // Write a whole section at once, e.g. one serialized on another thread
+    void write_section(std::string_view name, json lines)
+    {
+        result[std::string(name)] = std::move(lines);
+    }
+
     void write_line(std::string line)
     {
         if (current_section.empty()) {
@@ -224,6 +306,9 @@ public:
             shdr_json["addr"] = shdr.addr;
             shdr_json["offset"] = shdr.offset;
             shdr_json["size"] = shdr.size;
+            if (shdr.align > 1) {
+                shdr_json["align"] = shdr.align;
+            }
             shdrs_json.push_back(shdr_json);
         }
         result["shdrs"] = shdrs_json;
@@ -234,6 +319,15 @@ public:
         result["needed"] = needed;
     }
 
+    void write_symbol_index(const SymbolIndex& index)
+    {
+        json entries = json::array();
+        for (const auto& entry : index.entries) {
+            entries.push_back({ entry.start, entry.size, entry.name });
+        }
+        result["symbol_index"] = { { "names", index.names }, { "entries", entries } };
+    }
+
 private:
     std::string current_section;
     json result;
@@ -256,8 +350,30 @@ inline std::vector<uint8_t> generate_plt_stub(int32_t got_offset)
     return stub;
 }
 
+// Alignment of the static TLS block and of .tbss within it; ld rejects
+// thread-local input sections that need more
+constexpr uint64_t TLS_ALIGN = 16;
+
+// Layout of the static TLS block (x86-64 variant II): the .tdata image
+// followed by .tbss, ending at the thread pointer. A variable at template
+// offset off lives at TP + off - block_size.
+struct TLSLayout {
+    uint64_t tdata_size; // Bytes copied from the .tdata image
+    uint64_t tbss_offset; // Template offset of .tbss
+    uint64_t block_size; // Size of the block below the thread pointer
+};
+
+inline TLSLayout tls_layout(uint64_t tdata_size, uint64_t tbss_size)
+{
+    TLSLayout layout;
+    layout.tdata_size = tdata_size;
+    layout.tbss_offset = (tdata_size + TLS_ALIGN - 1) & ~(TLS_ALIGN - 1);
+    layout.block_size = (layout.tbss_offset + tbss_size + TLS_ALIGN - 1) & ~(TLS_ALIGN - 1);
+    return layout;
+}
+
 // Core functions that we provide
-FLEObject load_fle(const std::string& filename); // Load FLE file into memory
+FLEObject load_fle(const std::string& filename, bool metadata_only = false); // Load FLE file into memory; metadata_only skips section bytes
 void FLE_cc(const std::vector<std::string>& args); // Compile source files to FLE
 
 // Functions for students to implement
@@ -286,28 +402,110 @@ void FLE_objdump(const FLEObject& obj, FLEWriter& writer);
  */
 void FLE_nm(const FLEObject& obj);
 
+/**
+ * Map addresses of a linked image back to symbols using its symbol index
+ * @param obj The linked .exe or .so
+ * @param addrs Addresses to look up (relative to the load base for .so)
+ *
+ * Expected output format, one line per address:
+ * 0000000000401234 main+0x14
+ * 0000000000500000 ??
+ */
+void FLE_nm_lookup(const FLEObject& obj, const std::vector<uint64_t>& addrs);
+
+struct ExecOptions {
+    bool count_imports = false; // Count calls through GOT slots into other modules (--count-imports)
+    bool fork_server = false; // Load once, then fork a fresh run per request (--fork-server)
+    bool stats = false; // Report resource usage and hardware counters at exit (--stats)
+    size_t runs = 1; // --stats: number of runs to take the median over (--runs)
+    int pin_cpu = -1; // --stats: CPU to run on, -1 for any (--pin-cpu)
+};
+
+// Fork-server control pipes, inherited from the client: one line per run
+// request is read from the control fd, one status line per run is written
+// to the status fd ("ready <us>", then "<pid> exit|signal <n> <us>")
+constexpr int FORK_SERVER_CONTROL_FD = 198;
+constexpr int FORK_SERVER_STATUS_FD = 199;
+
 /**
  * Execute an FLE executable file
- * @param obj The FLE executable object
+ * @param obj The FLE executable object (or bundle); taken by value so its
+ *            section data can be released once it has been mapped
+ * @param options Loader options
  * @throws runtime_error if the file is not executable or _start symbol is not found
  */
-void FLE_exec(const FLEObject& obj);
+void FLE_exec(FLEObject obj, const ExecOptions& options = {});
+
+/**
+ * Point FS back at the loader's own TLS
+ *
+ * The program owns FS once FLE_exec jumps to it, so signal handlers in the
+ * loader must call this before using libc. Async-signal-safe.
+ */
+void FLE_exec_restore_tls();
+
+/**
+ * Describe an address of the running program as "symbol+0xoff (module)"
+ *
+ * Finds the loaded module containing addr and binary-searches its symbol
+ * index. Allocation-free, so signal handlers may call it after
+ * FLE_exec_restore_tls().
+ * @return false if no indexed symbol covers addr
+ */
+bool FLE_exec_symbolize(uint64_t addr, char* buf, size_t size);
+
+/**
+ * Pack an executable and its dependency closure into one bundle file
+ *
+ * Dependencies are found the way exec finds them (FLE_LIBRARY_PATH) and
+ * stored in exec's load order, each member named as it is referenced in
+ * "needed". Every symbol the members import is resolved once here, so
+ * exec can bind imports without searching the modules.
+ * @param output Bundle file to write
+ * @param program Executable to pack
+ * @throws runtime_error if a dependency or an imported symbol is missing
+ */
+void FLE_bundle(const std::string& output, const std::string& program);
 
 struct LinkerOptions {
     std::string outputFile = "a.out"; // 输出文件名 (用于设置 .so 的 name 属性)
     bool shared = false; // 是否生成共享库 (-shared)
     std::string entryPoint = "_start"; // 入口点名称 (默认为 _start)
     bool is_static = false; // 是否强制静态链接 (-static)
+    std::vector<bool> as_needed; // 与输入一一对应：该输入是否处于 --as-needed 作用范围内
+    std::string script; // 链接脚本内容 (-T)，为空时使用默认布局
+    std::map<std::string, uint64_t> section_start; // 输出节起始地址 (--section-start=.name=addr)
+    std::string call_graph_profile; // 调用图剖析内容 (--call-graph-profile)，每行 "caller callee weight"
 };
 
 /**
  * Link multiple FLE objects into an executable or shared library
+ *
+ * Parallel phases run on global_thread_pool(); the caller sizes it with
+ * set_thread_count before linking, FLE_ld never resizes it.
  * @param objects Vector of FLE objects to link
  * @param options Linker configuration options
  * @return A new FLE object (type ".exe" or ".so")
  */
 FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& options);
 
+/**
+ * Link objects that are shared with other links (e.g. in batch mode)
+ * @param objects Input objects; they are only read, never copied or modified
+ * @param options Linker configuration options
+ * @return A new FLE object (type ".exe" or ".so")
+ */
+FLEObject FLE_ld(const std::vector<const FLEObject*>& objects, const LinkerOptions& options);
+
+/**
+ * Check whether objects would link, without layout, relocation or output
+ * @param objects Vector of FLE objects to link (section bytes are not needed)
+ * @param options Linker configuration options
+ * @return One message per undefined or multiply-defined symbol; empty if the symbols resolve
+ */
+std::vector<std::string> FLE_ld_check(const std::vector<FLEObject>& objects, const LinkerOptions& options);
+std::vector<std::string> FLE_ld_check(const std::vector<const FLEObject*>& objects, const LinkerOptions& options);
+
 /**
  * Read FLE object file
  * @param obj The FLE object to read
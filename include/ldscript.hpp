@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Expression in a linker script: numbers, '.', symbols, ALIGN(), + and -
+struct ScriptExpr {
+    enum class Kind {
+        Number, // Literal value
+        Dot, // Location counter '.'
+        Symbol, // Previously assigned symbol
+        Align, // ALIGN(operands[0]): '.' rounded up
+        Add, // operands[0] + operands[1]
+        Sub // operands[0] - operands[1]
+    };
+
+    Kind kind = Kind::Number;
+    uint64_t value = 0;
+    std::string symbol;
+    std::vector<ScriptExpr> operands;
+};
+
+// One statement of a SECTIONS block (or of an output section body)
+struct ScriptCommand {
+    enum class Kind {
+        SetDot, // . = expr;
+        Assign, // symbol = expr;
+        OutputSection, // .name [addr] : [ALIGN(n)] { body }
+        Input // *(pattern ...) or KEEP(*(pattern ...))
+    };
+
+    Kind kind;
+    std::string name; // Symbol name (Assign) or output section name (OutputSection)
+    ScriptExpr expr; // Value (SetDot/Assign) or start address (OutputSection)
+    bool has_addr = false; // OutputSection: explicit start address given
+    bool has_align = false; // OutputSection: ALIGN(n) given after ':'
+    ScriptExpr align;
+    std::vector<std::string> patterns; // Input: section name globs
+    bool keep = false; // Input: wrapped in KEEP()
+    std::vector<ScriptCommand> body; // OutputSection: statements inside { }
+};
+
+struct LinkerScript {
+    std::vector<ScriptCommand> commands; // Contents of SECTIONS { } in order
+};
+
+// Layout used when no -T script is given: the classic .text/.rodata/.data/.bss image,
+// with the linker-generated .plt and .got after code and data, and the TLS
+// template (.tdata, .tbss) between .data and .bss
+constexpr const char* DEFAULT_LINKER_SCRIPT = "SECTIONS {"
+                                              "  . = 0x400000;"
+                                              "  .text : { *(.text*) }"
+                                              "  .plt : { *(.plt) }"
+                                              "  .rodata : { *(.rodata*) }"
+                                              "  .data : { *(.data*) }"
+                                              "  .got : { *(.got) }"
+                                              "  .tdata : { *(.tdata*) }"
+                                              "  .tbss : { *(.tbss*) }"
+                                              "  .bss : { *(.bss*) }"
+                                              "}";
+
+/**
+ * Parse the supported linker-script subset
+ * @param text Script source
+ * @throws runtime_error on syntax errors
+ */
+LinkerScript parse_linker_script(const std::string& text);
+
+/**
+ * Evaluate a script expression
+ * @param expr Expression to evaluate
+ * @param dot Current value of the location counter
+ * @param lookup Resolves symbol names; throws if the symbol is unknown
+ */
+uint64_t eval_script_expr(const ScriptExpr& expr, uint64_t dot,
+    const std::function<uint64_t(const std::string&)>& lookup);
+
+/**
+ * Match an input section name against a script glob ('*', '?', '[...]')
+ */
+bool script_pattern_match(const std::string& pattern, const std::string& name);
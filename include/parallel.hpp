@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool shared by all parallel phases
+ *
+ * Every worker owns a deque: it pops its own tasks from the back and,
+ * when that runs dry, steals from the front of the others. A thread
+ * waiting for a batch runs queued tasks itself, so nested parallel_for
+ * calls cannot deadlock. A pool of size 1 has no workers and runs
+ * everything on the calling thread.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads)
+        : queues(std::max<size_t>(num_threads, 1))
+    {
+        for (size_t i = 1; i < queues.size(); i++) {
+            workers.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total number of threads, including the caller
+    size_t size() const { return queues.size(); }
+
+    /**
+     * Run fn(i) for every i in [0, n) and wait for all of them
+     *
+     * If any call throws, the exception of the smallest failing index is
+     * rethrown after all calls have finished, which keeps error reporting
+     * independent of scheduling.
+     */
+    template <typename Fn>
+    void parallel_for(size_t n, Fn&& fn)
+    {
+        if (n == 0) {
+            return;
+        }
+        if (size() == 1 || n == 1) {
+            for (size_t i = 0; i < n; i++) {
+                fn(i);
+            }
+            return;
+        }
+
+        auto batch = std::make_shared<Batch>();
+        batch->first_error_index = n;
+
+        // A few chunks per thread leaves room for stealing to balance the load
+        size_t num_chunks = std::min(n, size() * 4);
+        batch->remaining = num_chunks;
+        for (size_t c = 0; c < num_chunks; c++) {
+            size_t begin = n * c / num_chunks;
+            size_t end = n * (c + 1) / num_chunks;
+            push(c % size(), [batch, begin, end, &fn]() {
+                for (size_t i = begin; i < end; i++) {
+                    try {
+                        fn(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(batch->mutex);
+                        if (i < batch->first_error_index) {
+                            batch->first_error_index = i;
+                            batch->first_error = std::current_exception();
+                        }
+                    }
+                }
+                if (--batch->remaining == 0) {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    batch->done.notify_all();
+                }
+            });
+        }
+
+        // Help out until the batch is finished
+        while (batch->remaining > 0) {
+            std::function<void()> task;
+            if (try_pop(0, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(batch->mutex);
+            batch->done.wait(lock, [&]() { return batch->remaining == 0; });
+        }
+
+        if (batch->first_error) {
+            std::rethrow_exception(batch->first_error);
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    struct Batch {
+        std::atomic<size_t> remaining { 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr first_error;
+        size_t first_error_index = 0;
+    };
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending { 0 };
+    bool stopping = false;
+
+    void push(size_t queue_index, std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queues[queue_index].mutex);
+            queues[queue_index].tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            pending++;
+        }
+        wake.notify_one();
+    }
+
+    // Pop from our own queue first, then steal from the others
+    bool try_pop(size_t self, std::function<void()>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queues[self].mutex);
+            if (!queues[self].tasks.empty()) {
+                task = std::move(queues[self].tasks.back());
+                queues[self].tasks.pop_back();
+                pending--;
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue& victim = queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                pending--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t self)
+    {
+        while (true) {
+            std::function<void()> task;
+            if (try_pop(self, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [&]() { return stopping || pending > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+    }
+};
+
+// Pool used by parallel_for; rebuilt when the thread count changes
+inline std::unique_ptr<ThreadPool>& global_thread_pool_slot()
+{
+    static std::unique_ptr<ThreadPool> pool;
+    return pool;
+}
+
+/**
+ * Set the number of threads used by parallel phases
+ * @param num_threads Thread count; 0 means one per hardware thread
+ */
+inline void set_thread_count(size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto& pool = global_thread_pool_slot();
+    if (!pool || pool->size() != num_threads) {
+        pool.reset();
+        pool = std::make_unique<ThreadPool>(num_threads);
+    }
+}
+
+inline ThreadPool& global_thread_pool()
+{
+    if (!global_thread_pool_slot()) {
+        set_thread_count(0);
+    }
+    return *global_thread_pool_slot();
+}
+
+// Run fn(i) for every i in [0, n) on the shared pool
+template <typename Fn>
+void parallel_for(size_t n, Fn&& fn)
+{
+    global_thread_pool().parallel_for(n, std::forward<Fn>(fn));
+}
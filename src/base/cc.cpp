@@ -52,7 +52,9 @@ constexpr auto RELOCATION_FORMATS = std::array {
     std::pair { "R_X86_64_32S"sv, RelocationFormat { ".abs32s"sv, 4 } },
     std::pair { "R_X86_64_GOTPCREL"sv, RelocationFormat { ".gotpcrel"sv, 4 } },
     std::pair { "R_X86_64_GOTPCRELX"sv, RelocationFormat { ".gotpcrel"sv, 4 } },
-    std::pair { "R_X86_64_REX_GOTPCRELX"sv, RelocationFormat { ".gotpcrel"sv, 4 } }
+    std::pair { "R_X86_64_REX_GOTPCRELX"sv, RelocationFormat { ".gotpcrel"sv, 4 } },
+    std::pair { "R_X86_64_TPOFF32"sv, RelocationFormat { ".tpoff32"sv, 4 } },
+    std::pair { "R_X86_64_GOTTPOFF"sv, RelocationFormat { ".gottpoff"sv, 4 } }
 };
 
 // 解析符号表
@@ -264,7 +266,7 @@ void FLE_cc(const std::vector<std::string>& options)
 
     // 处理每个节
     static const std::regex section_pattern {
-        R"(^\s*([0-9]+)\s+(\.(\w|\.)+)\s+([0-9a-fA-F]+)\s+.*$)"
+        R"(^\s*([0-9]+)\s+(\.(\w|\.)+)\s+([0-9a-fA-F]+)\s+.*\s2\*\*([0-9]+)\s*$)"
     };
 
     auto lines = splitlines(objdump_output);
@@ -292,6 +294,7 @@ void FLE_cc(const std::vector<std::string>& options)
             flags.push_back(trim(flag));
         }
         size_t size = std::stoul(match[4].str(), nullptr, 16);
+        uint64_t align = uint64_t(1) << std::stoul(match[5].str());
 
         // 检查是否需要处理该节
         if (!contains(flags, "ALLOC") || str_contains(section_name, "note.gnu.property") || size == 0) {
@@ -307,6 +310,9 @@ void FLE_cc(const std::vector<std::string>& options)
         if (contains(flags, "EXECINSTR")) {
             sh_flags |= SHF::EXEC;
         }
+        if (contains(flags, "THREAD_LOCAL")) {
+            sh_flags |= SHF::TLS;
+        }
 
         const bool is_nobits = !contains(flags, "CONTENTS");
         if (is_nobits) {
@@ -321,6 +327,7 @@ void FLE_cc(const std::vector<std::string>& options)
             .addr = 0,
             .offset = current_offset,
             .size = size,
+            .align = align,
         });
 
         current_offset += size;
@@ -7,6 +7,7 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -122,6 +123,14 @@ void FLE_disasm(const FLEObject& obj, const std::string& section_name)
         }
     }
 
+    // 链接产物中该节的虚拟地址，用于查符号索引
+    std::optional<uint64_t> section_vaddr;
+    for (const auto& phdr : obj.phdrs) {
+        if (phdr.name == section_name && !obj.symbol_index.entries.empty()) {
+            section_vaddr = phdr.vaddr;
+        }
+    }
+
     std::cout << "Disassembly of section " << section_name << ":" << std::endl;
 
     // 如果是数据段，直接显示数据
@@ -233,6 +242,13 @@ void FLE_disasm(const FLEObject& obj, const std::string& section_name)
                         std::cout << std::endl; // 在符号前添加空行
                         std::cout << sym_it->second->name << ":" << std::endl;
                     }
+                } else if (section_vaddr) {
+                    // 链接产物：在按地址排序的符号索引中二分查找
+                    const SymbolIndexEntry* entry = obj.symbol_index.lookup(*section_vaddr + addr);
+                    if (entry != nullptr && entry->start == *section_vaddr + addr) {
+                        std::cout << std::endl;
+                        std::cout << obj.symbol_index.names[entry->name] << ":" << std::endl;
+                    }
                 }
 
                 // 提取机器码和指令
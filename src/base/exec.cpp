@@ -1,23 +1,163 @@
 #include "fle.hpp"
 #include "string_utils.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <csignal>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
+#include <asm/prctl.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sched.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace {
 
+/**
+ * Thread control block, placed at the thread pointer
+ *
+ * Besides the self pointer and stack guard the x86-64 ABI expects, the
+ * loader publishes where the TLS template lives, so the runtime
+ * (minilibc's thread_create) can set up TLS for the threads it starts,
+ * and where its services for the program (dlopen, ...) are.
+ */
+struct ThreadControlBlock {
+    uint64_t self; // 0x00: %fs:0 must hold the thread pointer itself
+    uint64_t tls_image; // 0x08: Address of the .tdata image
+    uint64_t tls_image_size; // 0x10: Bytes to copy from the image; the rest of the block is zero
+    uint64_t tls_block_size; // 0x18: Size of the block below the thread pointer
+    uint64_t services; // 0x20: Address of the LoaderServices table
+    uint64_t stack_guard; // 0x28: Read by -fstack-protector code
+    uint64_t padding[2];
+};
+static_assert(sizeof(ThreadControlBlock) == 64, "minilibc relies on the TCB layout");
+
+void* service_dlopen(const char* name);
+void* service_dlsym(void* handle, const char* name);
+const char* service_dlerror();
+
+// Loader entry points for the program, found through the TCB; minilibc
+// wraps them as __fle_dlopen, __fle_dlsym and __fle_dlerror
+struct LoaderServices {
+    void* (*dlopen)(const char* name);
+    void* (*dlsym)(void* handle, const char* name);
+    const char* (*dlerror)();
+};
+
+const LoaderServices loader_services = { service_dlopen, service_dlsym, service_dlerror };
+
+// Loader's own thread pointer, saved before FS is handed to the program
+uint64_t loader_thread_pointer = 0;
+
+long set_thread_pointer(uint64_t tp)
+{
+    // Raw syscall: libc's wrapper would touch errno, which lives in TLS
+    long ret;
+    asm volatile("syscall"
+                 : "=a"(ret)
+                 : "a"(SYS_arch_prctl), "D"(ARCH_SET_FS), "S"(tp)
+                 : "rcx", "r11", "memory");
+    return ret;
+}
+
+/**
+ * Allocate the initial thread's static TLS block and TCB
+ *
+ * The block holds a copy of the .tdata image followed by zeroed .tbss,
+ * laid out by tls_layout() exactly as ld computed the TP offsets. Every
+ * program gets a TCB, even without TLS, so threads can always find the
+ * template through %fs.
+ * @return Thread pointer to load into FS
+ */
+uint64_t setup_initial_tls(const FLEObject& obj)
+{
+    uint64_t tdata_vaddr = 0;
+    uint64_t tdata_size = 0;
+    uint64_t tbss_size = 0;
+    for (const auto& phdr : obj.phdrs) {
+        if (phdr.name == ".tdata") {
+            tdata_vaddr = phdr.vaddr;
+            tdata_size = phdr.size;
+        } else if (phdr.name == ".tbss") {
+            tbss_size = phdr.size;
+        }
+    }
+    TLSLayout tls = tls_layout(tdata_size, tbss_size);
+
+    void* block = mmap(nullptr, tls.block_size + sizeof(ThreadControlBlock), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        throw std::runtime_error("Failed to allocate TLS block");
+    }
+    uint64_t tp = reinterpret_cast<uint64_t>(block) + tls.block_size;
+    if (tdata_size != 0) {
+        memcpy(reinterpret_cast<void*>(tp - tls.block_size), reinterpret_cast<void*>(tdata_vaddr), tdata_size);
+    }
+
+    // Keep the loader's stack guard so code built with -fstack-protector
+    // keeps working
+    auto* tcb = reinterpret_cast<ThreadControlBlock*>(tp);
+    tcb->self = tp;
+    tcb->tls_image = tdata_vaddr;
+    tcb->tls_image_size = tdata_size;
+    tcb->tls_block_size = tls.block_size;
+    tcb->services = reinterpret_cast<uint64_t>(&loader_services);
+    asm volatile("mov %%fs:0x28, %0" : "=r"(tcb->stack_guard));
+    return tp;
+}
+
+// A mapped segment of a loaded module
+struct LoadedSegment {
+    std::string name;
+    uint64_t addr; // Runtime address
+    uint64_t size;
+    uint32_t flags; // PHF bits
+};
+
+// A GLOBAL or WEAK definition of a loaded module
+struct ExportedSymbol {
+    uint64_t addr; // Runtime address
+    uint64_t size;
+};
+
+/**
+ * What the loader keeps of a module once it is mapped
+ *
+ * Section bytes live only in the mapping; the parsed FLEObject is dropped
+ * right after map_module. Relocations are rebased to runtime addresses,
+ * and the section relocations go away once they have been applied.
+ */
 struct LoadedModule {
     std::string name;
-    FLEObject obj;
-    uint64_t load_base;
-    std::map<std::string, uint64_t> section_addrs;
+    std::string type; // ".exe" or ".so"
+    uint64_t load_base = 0;
+    uint64_t map_start = 0; // Address range reserved for a .so
+    uint64_t map_size = 0;
+    std::vector<LoadedSegment> segments;
+    std::unordered_map<std::string, ExportedSymbol> exports;
+    std::vector<Relocation> dyn_relocs; // Kept for copy relocations and --count-imports
+    std::vector<Relocation> section_relocs; // Until relocate_module has applied them
+    SymbolIndex symbol_index; // Addresses relative to load_base
 };
 
 // Global list of loaded modules to maintain loading order
@@ -25,25 +165,55 @@ struct LoadedModule {
 std::vector<LoadedModule> loaded_modules;
 std::unordered_set<std::string> loaded_module_names;
 
-// Flag: true if any SO has PC32 dyn_relocs (requires all SOs in low address space)
+// Flag: true if any SO has PC32 dyn_relocs (requires every module within PC32 reach)
 bool need_low_address = false;
 std::unordered_set<std::string> scanned_names;
+// Libraries parsed by the pre-scan, kept so loading them does not parse again
+std::map<std::string, FLEObject> scanned_objects;
+
+/**
+ * Where libraries go in the address space
+ *
+ * Before anything is mapped, the footprint of every library known at
+ * startup is summed and one range is reserved right above the executable.
+ * The libraries are then packed into it back to back, in load order, so
+ * code that calls across modules stays close together and within PC32
+ * reach. Libraries loaded later (dlopen) get ranges of their own, placed
+ * the same way and held to the same reach.
+ */
+struct AddressPlan {
+    uint64_t exe_start = 0; // Range of the executable's segments
+    uint64_t exe_end = 0;
+    uint64_t next = 0; // Next free byte of the startup reservation
+    uint64_t end = 0; // End of the startup reservation
+    uint64_t top = 0; // End of the highest range reserved so far
+};
 
-// Helper to load FLE from file (searches FLE_LIBRARY_PATH)
-FLEObject load_fle_with_path(const std::string& filename)
+AddressPlan address_plan;
+
+constexpr uint64_t PAGE_SIZE = 4096;
+// Largest distance a PC32 relocation can span
+constexpr uint64_t PC32_REACH = 0x7fffffff;
+
+// Members of the bundle being run, by the name they are needed under
+std::map<std::string, FLEObject*> bundle_members;
+// Its pre-bound imports; only set while the load order matches the bundle's
+const std::map<std::string, BundleBinding>* bundle_bindings = nullptr;
+
+// Path of an FLE file: as given, with ".fle" appended, then in each
+// FLE_LIBRARY_PATH directory by basename and by the name as given
+std::string find_fle_file(const std::string& filename)
 {
-    // Try direct path
-    try {
-        return load_fle(filename);
-    } catch (...) {
+    auto exists = [](const std::string& path) {
+        return access(path.c_str(), R_OK) == 0;
+    };
+    if (exists(filename)) {
+        return filename;
     }
-
-    try {
-        return load_fle(filename + ".fle");
-    } catch (...) {
+    if (exists(filename + ".fle")) {
+        return filename + ".fle";
     }
 
-    // Search in FLE_LIBRARY_PATH
     const char* lib_path_env = std::getenv("FLE_LIBRARY_PATH");
     if (lib_path_env != nullptr) {
         std::string lib_path(lib_path_env);
@@ -66,19 +236,54 @@ FLEObject load_fle_with_path(const std::string& filename)
             paths.push_back(lib_path.substr(start));
 
         for (const auto& path : paths) {
-            try {
-                return load_fle(path + "/" + basename);
-            } catch (...) {
+            if (exists(path + "/" + basename)) {
+                return path + "/" + basename;
             }
-            try {
-                return load_fle(path + "/" + filename);
-            } catch (...) {
+            if (exists(path + "/" + filename)) {
+                return path + "/" + filename;
             }
         }
     }
     throw std::runtime_error("Could not load: " + filename);
 }
 
+// Helper to load FLE by name: from the bundle if there is one, else from disk
+// A pre-scanned object is handed over rather than copied
+FLEObject load_fle_with_path(const std::string& filename)
+{
+    auto scanned = scanned_objects.find(filename);
+    if (scanned != scanned_objects.end()) {
+        FLEObject obj = std::move(scanned->second);
+        scanned_objects.erase(scanned);
+        return obj;
+    }
+    auto it = bundle_members.find(filename);
+    if (it != bundle_members.end()) {
+        return *it->second;
+    }
+    return load_fle(find_fle_file(filename));
+}
+
+// Drop everything of a parsed module but its headers (type, phdrs, entry, needed)
+void release_contents(FLEObject& obj)
+{
+    obj.sections = std::map<std::string, FLESection>();
+    obj.symbols = std::vector<Symbol>();
+    obj.dyn_relocs = std::vector<Relocation>();
+    obj.symbol_index = SymbolIndex();
+}
+
+// PC32 dynamic relocations only reach modules within +-2 GiB of the patched code
+bool has_pc32_dyn_relocs(const FLEObject& obj)
+{
+    for (const auto& reloc : obj.dyn_relocs) {
+        if (reloc.type == RelocationType::R_X86_64_PC32) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Pre-scan dependencies to check if any SO has PC32 dyn_relocs
 void scan_dependencies_recursive(const std::string& filename)
 {
@@ -93,114 +298,268 @@ void scan_dependencies_recursive(const std::string& filename)
     }
 
     scanned_names.insert(filename);
+    const FLEObject& scanned = scanned_objects[filename] = std::move(obj);
 
     // Check for PC32 dyn_relocs
-    if (obj.type == ".so") {
-        for (const auto& reloc : obj.dyn_relocs) {
-            if (reloc.type == RelocationType::R_X86_64_PC32) {
-                need_low_address = true;
-                break;
-            }
-        }
+    if (scanned.type == ".so" && has_pc32_dyn_relocs(scanned)) {
+        need_low_address = true;
     }
 
     // Recurse into dependencies
-    for (const auto& dep : obj.needed) {
+    for (const auto& dep : scanned.needed) {
         scan_dependencies_recursive(dep);
     }
 }
 
-// Helper to resolve a symbol across all loaded modules
-uint64_t resolve_symbol(const std::string& name)
+// Page-aligned [first, end) of the vaddrs a library's segments cover
+std::pair<uint64_t, uint64_t> module_extent(const FLEObject& obj)
 {
-    for (const auto& mod : loaded_modules) {
-        for (const auto& sym : mod.obj.symbols) {
-            // We search for GLOBAL or WEAK symbols that are defined (not UNDEFINED)
-            if (sym.name == name && (sym.type == SymbolType::GLOBAL || sym.type == SymbolType::WEAK)) {
-                auto it = mod.section_addrs.find(sym.section);
-                if (it != mod.section_addrs.end()) {
-                    return it->second + sym.offset;
-                }
+    uint64_t first = UINT64_MAX;
+    uint64_t end = 0;
+    for (const auto& phdr : obj.phdrs) {
+        if (phdr.size > 0) {
+            first = std::min(first, phdr.vaddr);
+            end = std::max(end, phdr.vaddr + phdr.size);
+        }
+    }
+    if (end == 0) {
+        return { 0, 0 };
+    }
+    return { first & ~(PAGE_SIZE - 1), (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1) };
+}
+
+// Bytes a library occupies once mapped, in whole pages
+uint64_t module_footprint(const FLEObject& obj)
+{
+    auto [first, end] = module_extent(obj);
+    return end - first;
+}
+
+/**
+ * Reserve size bytes for libraries, as close above the executable as possible
+ *
+ * The range right after everything placed so far comes first; when that is
+ * taken, MAP_32BIT keeps PC32 code near the executable at low addresses,
+ * and code without PC32 relocations may go anywhere.
+ * @param what Libraries the range is for, for the error message
+ * @throws runtime_error if no range is free or PC32 reach would be broken
+ */
+uint64_t reserve_library_range(uint64_t size, const std::string& what)
+{
+    uint64_t hint = std::max(address_plan.exe_end, address_plan.top);
+    hint = (hint + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    void* addr = mmap(reinterpret_cast<void*>(hint), size, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    // Kernels without MAP_FIXED_NOREPLACE take the address as a mere hint
+    if (addr != MAP_FAILED && reinterpret_cast<uint64_t>(addr) != hint) {
+        munmap(addr, size);
+        addr = MAP_FAILED;
+    }
+    if (addr == MAP_FAILED) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | (need_low_address ? MAP_32BIT : 0);
+        addr = mmap(nullptr, size, PROT_NONE, flags, -1, 0);
+    }
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("loader: cannot reserve " + std::to_string(size) + " bytes for " + what
+            + ": " + strerror(errno));
+    }
+    uint64_t start = reinterpret_cast<uint64_t>(addr);
+
+    if (need_low_address) {
+        uint64_t low = std::min(start, address_plan.exe_start);
+        uint64_t high = std::max(start + size, address_plan.exe_end);
+        for (const auto& mod : loaded_modules) {
+            if (mod.map_size != 0) {
+                low = std::min(low, mod.map_start);
+                high = std::max(high, mod.map_start + mod.map_size);
             }
         }
+        if (high - low > PC32_REACH) {
+            munmap(addr, size);
+            std::ostringstream msg;
+            msg << "loader: " << what << " (" << size << " bytes) cannot be placed within PC32 reach"
+                << " of the other modules: they would span 0x" << std::hex << low << "-0x" << high;
+            throw std::runtime_error(msg.str());
+        }
     }
-    throw std::runtime_error("Symbol not found: " + name);
+    address_plan.top = std::max(address_plan.top, start + size);
+    return start;
 }
 
-void load_module_recursive(const std::string& filename)
+// Reserve the startup range for the libraries reachable from roots
+void plan_address_space(const std::vector<std::string>& roots)
 {
-    if (loaded_module_names.count(filename)) {
-        return;
+    uint64_t total = 0;
+    std::unordered_set<std::string> seen;
+    std::function<void(const std::string&)> visit = [&](const std::string& name) {
+        auto it = scanned_objects.find(name);
+        if (!seen.insert(name).second || it == scanned_objects.end()) {
+            return;
+        }
+        total += module_footprint(it->second);
+        for (const auto& dep : it->second.needed) {
+            visit(dep);
+        }
+    };
+    for (const auto& root : roots) {
+        visit(root);
+    }
+    if (total != 0) {
+        address_plan.next = reserve_library_range(total, std::to_string(seen.size()) + " libraries");
+        address_plan.end = address_plan.next + total;
     }
+}
 
-    // Load FLE file
-    // Try direct path first, then search in FLE_LIBRARY_PATH
-    FLEObject obj;
-    bool loaded = false;
+// Load base for a library: the next slot of the startup range, or a range of its own
+uint64_t allocate_library_range(uint64_t size, const std::string& name)
+{
+    if (address_plan.end - address_plan.next >= size) {
+        uint64_t base = address_plan.next;
+        address_plan.next += size;
+        return base;
+    }
+    return reserve_library_range(size, name);
+}
 
-    // Try direct path
-    try {
-        obj = load_fle(filename);
-        loaded = true;
-    } catch (...) {
-        // Try with extensions
-        try {
-            obj = load_fle(filename + ".fle");
-            loaded = true;
-        } catch (...) {
-            // Continue to search in library path
+/**
+ * Libraries named by FLE_PRELOAD, separated by ':' or whitespace
+ *
+ * They are loaded right after the executable and before its needed list,
+ * so their definitions come first in resolve_symbol's search and take over
+ * every reference that is bound at load time.
+ */
+std::vector<std::string> preload_libraries()
+{
+    std::vector<std::string> names;
+    const char* env = std::getenv("FLE_PRELOAD");
+    if (env == nullptr) {
+        return names;
+    }
+    std::string name;
+    for (const char* p = env;; p++) {
+        if (*p == '\0' || *p == ':' || std::isspace(static_cast<unsigned char>(*p))) {
+            if (!name.empty()) {
+                names.push_back(name);
+                name.clear();
+            }
+            if (*p == '\0') {
+                break;
+            }
+        } else {
+            name += *p;
         }
     }
+    return names;
+}
 
-    // If not found, search in FLE_LIBRARY_PATH
-    if (!loaded) {
-        const char* lib_path_env = std::getenv("FLE_LIBRARY_PATH");
-        if (lib_path_env != nullptr) {
-            std::string lib_path(lib_path_env);
-            std::string basename = filename;
-            // Extract basename from path if it contains directory separators
-            size_t last_slash = filename.rfind('/');
-            if (last_slash != std::string::npos) {
-                basename = filename.substr(last_slash + 1);
-            }
+// Mapped segment of mod with the given name, or nullptr
+const LoadedSegment* find_segment(const LoadedModule& mod, const std::string& name)
+{
+    for (const auto& segment : mod.segments) {
+        if (segment.name == name) {
+            return &segment;
+        }
+    }
+    return nullptr;
+}
 
-            // Split FLE_LIBRARY_PATH by ':'
-            std::vector<std::string> paths;
-            size_t start = 0;
-            size_t end = lib_path.find(':');
-            while (end != std::string::npos) {
-                if (end > start) {
-                    paths.push_back(lib_path.substr(start, end - start));
-                }
-                start = end + 1;
-                end = lib_path.find(':', start);
+// Helper to resolve a symbol across all loaded modules, starting at module `first`
+// The executable comes first, so its definitions (and copies) win over the libraries'
+uint64_t resolve_symbol(const std::string& name, size_t first = 0, const ExportedSymbol** found = nullptr)
+{
+    if (bundle_bindings != nullptr && first == 0 && found == nullptr) {
+        auto it = bundle_bindings->find(name);
+        if (it != bundle_bindings->end()) {
+            const auto& mod = loaded_modules[it->second.member];
+            const LoadedSegment* segment = find_segment(mod, it->second.section);
+            if (segment != nullptr) {
+                return segment->addr + it->second.offset;
             }
-            if (start < lib_path.size()) {
-                paths.push_back(lib_path.substr(start));
+        }
+    }
+    for (size_t i = first; i < loaded_modules.size(); i++) {
+        auto it = loaded_modules[i].exports.find(name);
+        if (it != loaded_modules[i].exports.end()) {
+            if (found) {
+                *found = &it->second;
             }
+            return it->second.addr;
+        }
+    }
+    throw std::runtime_error("Symbol not found: " + name);
+}
 
-            // Try each path
-            for (const auto& path : paths) {
-                std::string full_path = path + "/" + basename;
-                try {
-                    obj = load_fle(full_path);
-                    loaded = true;
-                    break;
-                } catch (...) {
-                    // Try original filename (maybe it's a relative path)
-                    try {
-                        obj = load_fle(path + "/" + filename);
-                        loaded = true;
-                        break;
-                    } catch (...) {
-                        // Continue searching
-                    }
-                }
+/**
+ * Map obj's segments at mod.load_base + vaddr and fill in the rest of mod
+ *
+ * Section bytes are copied into the mapping, relocations are rebased to
+ * runtime addresses and the symbols become a hash table of exports, so
+ * nothing of obj but its headers is needed afterwards.
+ */
+void map_module(LoadedModule& mod, FLEObject& obj)
+{
+    mod.type = obj.type;
+    for (const auto& phdr : obj.phdrs) {
+        if (phdr.size == 0)
+            continue;
+
+        void* target_addr = (void*)(mod.load_base + phdr.vaddr);
+        void* map_res = mmap(target_addr, phdr.size,
+            PROT_READ | PROT_WRITE, // Always RW initially for copying and relocation
+            MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+
+        if (map_res == MAP_FAILED) {
+            throw std::runtime_error("Failed to map segment " + phdr.name + ": " + strerror(errno));
+        }
+
+        // Copy section data
+        auto it = obj.sections.find(phdr.name);
+        if (it == obj.sections.end()) {
+            throw std::runtime_error("Section data not found for segment: " + phdr.name);
+        }
+        // NOBITS sections stay as the zero pages of the anonymous mapping
+        if (!it->second.nobits) {
+            memcpy(target_addr, it->second.data.data(), std::min<size_t>(phdr.size, it->second.data.size()));
+        }
+
+        // In FLE, section relocs have offset relative to the section start
+        for (auto reloc : it->second.relocs) {
+            reloc.offset += reinterpret_cast<uint64_t>(target_addr);
+            mod.section_relocs.push_back(std::move(reloc));
+        }
+        mod.segments.push_back({ phdr.name, reinterpret_cast<uint64_t>(target_addr), phdr.size, phdr.flags });
+    }
+
+    // For .so, dyn_relocs.offset is relative to the load base; for .exe it is the VMA and load_base is 0
+    mod.dyn_relocs = std::move(obj.dyn_relocs);
+    for (auto& reloc : mod.dyn_relocs) {
+        reloc.offset += mod.load_base;
+    }
+
+    // Defined GLOBAL and WEAK symbols in mapped sections; the first definition of a name wins
+    for (const auto& sym : obj.symbols) {
+        if (sym.type == SymbolType::GLOBAL || sym.type == SymbolType::WEAK) {
+            const LoadedSegment* segment = find_segment(mod, sym.section);
+            if (segment != nullptr) {
+                mod.exports.emplace(sym.name, ExportedSymbol { segment->addr + sym.offset, sym.size });
             }
         }
     }
+    mod.symbol_index = std::move(obj.symbol_index);
+    release_contents(obj);
+}
+
+void load_module_recursive(const std::string& filename)
+{
+    if (loaded_module_names.count(filename)) {
+        return;
+    }
 
-    if (!loaded) {
+    // Load FLE file from the bundle, the direct path or FLE_LIBRARY_PATH
+    FLEObject obj;
+    try {
+        obj = load_fle_with_path(filename);
+    } catch (...) {
         throw std::runtime_error("Could not load dependency: " + filename);
     }
 
@@ -209,117 +568,763 @@ void load_module_recursive(const std::string& filename)
     // Prepare LoadedModule structure
     LoadedModule mod;
     mod.name = filename;
-    mod.obj = obj;
 
     // Determine load base and map memory
     if (obj.type == ".exe") {
         mod.load_base = 0; // Exe has absolute addresses usually
     } else {
-        // For shared objects, we need to find a space.
-        // Calculate total size required
-        uint64_t min_vaddr = UINT64_MAX;
-        uint64_t max_end = 0;
-        bool has_segments = false;
+        // Shared objects go where the address plan says; the range starts at
+        // their lowest segment, not at vaddr 0
+        auto [first, end] = module_extent(obj);
+        if (end != 0) {
+            mod.map_start = allocate_library_range(end - first, filename);
+            mod.map_size = end - first;
+            mod.load_base = mod.map_start - first;
+        } else {
+            mod.load_base = 0;
+        }
+    }
 
-        for (const auto& phdr : obj.phdrs) {
-            if (phdr.size > 0) {
-                if (phdr.vaddr < min_vaddr)
-                    min_vaddr = phdr.vaddr;
-                uint64_t end = phdr.vaddr + phdr.size;
-                if (end > max_end)
-                    max_end = end;
-                has_segments = true;
-            }
+    map_module(mod, obj);
+
+    // Add to specific list location (Global symbol resolution order)
+    loaded_modules.push_back(std::move(mod));
+
+    // Recursively load dependencies
+    for (const auto& dep : obj.needed) {
+        load_module_recursive(dep);
+    }
+}
+
+// Patch one relocation at its runtime address (reloc.offset)
+void apply_relocation(const Relocation& reloc)
+{
+    uint64_t sym_addr = resolve_symbol(reloc.symbol);
+    uint64_t reloc_addr = reloc.offset;
+
+    switch (reloc.type) {
+    case RelocationType::R_X86_64_64:
+        *(uint64_t*)reloc_addr = sym_addr + reloc.addend;
+        break;
+    case RelocationType::R_X86_64_32:
+        *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend);
+        break;
+    case RelocationType::R_X86_64_32S:
+        *(int32_t*)reloc_addr = (int32_t)(sym_addr + reloc.addend);
+        break;
+    case RelocationType::R_X86_64_PC32:
+        // S + A - P
+        *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend - reloc_addr);
+        break;
+    case RelocationType::R_X86_64_GOTPCREL:
+        *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend - reloc_addr);
+        break;
+    case RelocationType::R_X86_64_TPOFF32:
+    case RelocationType::R_X86_64_GOTTPOFF:
+        throw std::runtime_error("TLS relocations must be resolved by ld: " + reloc.symbol);
+    case RelocationType::R_X86_64_COPY:
+        throw std::runtime_error("Copy relocations must be dynamic: " + reloc.symbol);
+    }
+}
+
+// Apply the dynamic and section relocations of one mapped module
+void relocate_module(LoadedModule& mod)
+{
+    // A. Dynamic Relocations (Bonus 1 - Text Relocations for SO, Bonus 2 - GOT for EXE)
+    for (const auto& reloc : mod.dyn_relocs) {
+        // Copies are made once every library has been relocated
+        if (reloc.type != RelocationType::R_X86_64_COPY) {
+            apply_relocation(reloc);
         }
+    }
+
+    // B. Section Relocations (Bonus 1 - Text Relocations)
+    for (const auto& reloc : mod.section_relocs) {
+        apply_relocation(reloc);
+    }
+    // Nothing needs them again
+    mod.section_relocs = std::vector<Relocation>();
+}
 
-        if (has_segments) {
-            uint64_t total_size = max_end;
+// Apply the final segment permissions of a relocated module
+void protect_module(const LoadedModule& mod)
+{
+    for (const auto& segment : mod.segments) {
+        mprotect((void*)segment.addr, segment.size,
+            (segment.flags & PHF::R ? PROT_READ : 0)
+                | (segment.flags & PHF::W ? PROT_WRITE : 0)
+                | (segment.flags & PHF::X ? PROT_EXEC : 0));
+    }
+}
 
-            void* addr;
-            if (need_low_address) {
-                // Use MAP_32BIT for PC32 text relocations (can only reach ±2GB)
-                std::cerr << "Warning: Loading " << filename << " into low 32-bit address space due to PC32 relocations." << std::endl;
-                addr = mmap(NULL, total_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
-                if (addr == MAP_FAILED) {
-                    // Fallback without MAP_32BIT
-                    addr = mmap(NULL, total_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+// Module whose mapped segments contain addr, or nullptr
+const LoadedModule* module_at(uint64_t addr, bool* executable = nullptr)
+{
+    for (const auto& mod : loaded_modules) {
+        for (const auto& segment : mod.segments) {
+            if (addr >= segment.addr && addr < segment.addr + segment.size) {
+                if (executable) {
+                    *executable = segment.flags & PHF::X;
                 }
-            } else {
-                // PIC code (GOT/PLT with R_X86_64_64) can be loaded anywhere
-                addr = mmap(NULL, total_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                return &mod;
             }
+        }
+    }
+    return nullptr;
+}
+
+// Per-import record for --count-imports; one cache line each, so threads
+// calling different imports do not contend
+struct alignas(64) ImportCounter {
+    uint64_t count; // Incremented by the stub on every call
+    uint64_t target; // Real function the stub jumps to
+};
 
-            if (addr == MAP_FAILED) {
-                throw std::runtime_error("Failed to reserve memory for shared library");
+struct CountedImport {
+    std::string name;
+    std::string module; // Module that defines the function
+    const ImportCounter* counter;
+};
+
+std::vector<CountedImport> counted_imports;
+
+// lock incq (8 bytes) + jmp *mem (6 bytes), padded with int3
+constexpr size_t IMPORT_STUB_SIZE = 16;
+
+/**
+ * Route every GOT slot bound to another module's function through a
+ * counting stub:
+ *
+ *     lock incq counter(%rip)
+ *     jmp *target(%rip)
+ *
+ * The stub touches no registers, only flags, which are dead at a call.
+ * A locked add is how x86 does a relaxed atomic fetch_add, so counts from
+ * concurrent threads are exact. PLT entries jump through the same slots,
+ * so both PLT calls and -fno-plt calls are counted.
+ *
+ * Stubs and counters live in a MAP_SHARED mapping so they outlive the
+ * program, which leaves through exit_group: the loader's parent process
+ * reads them after the program is gone.
+ */
+void install_import_counters()
+{
+    struct Slot {
+        uint64_t* addr;
+        size_t import_index;
+    };
+    std::vector<Slot> slots;
+    std::map<uint64_t, size_t> import_by_target;
+    std::vector<uint64_t> targets;
+    counted_imports.clear();
+
+    for (const auto& mod : loaded_modules) {
+        const LoadedSegment* got = find_segment(mod, ".got");
+        if (got == nullptr) {
+            continue;
+        }
+        uint64_t got_start = got->addr;
+        uint64_t got_end = got->addr + got->size;
+
+        for (const auto& reloc : mod.dyn_relocs) {
+            uint64_t reloc_addr = reloc.offset;
+            if (reloc.type != RelocationType::R_X86_64_64 || reloc.addend != 0
+                || reloc_addr < got_start || reloc_addr >= got_end) {
+                continue;
             }
-            mod.load_base = (uint64_t)addr;
-        } else {
-            mod.load_base = 0;
+            uint64_t target = *reinterpret_cast<uint64_t*>(reloc_addr);
+            bool executable = false;
+            const LoadedModule* owner = module_at(target, &executable);
+            if (owner == nullptr || owner == &mod || !executable) {
+                continue;
+            }
+            auto [it, inserted] = import_by_target.emplace(target, targets.size());
+            if (inserted) {
+                targets.push_back(target);
+                counted_imports.push_back({ reloc.symbol, owner->name, nullptr });
+            }
+            slots.push_back({ reinterpret_cast<uint64_t*>(reloc_addr), it->second });
         }
     }
+    if (targets.empty()) {
+        return;
+    }
 
-    // Map segments
-    for (const auto& phdr : obj.phdrs) {
-        if (phdr.size == 0)
+    size_t code_size = (targets.size() * IMPORT_STUB_SIZE + 4095) & ~size_t(4095);
+    size_t total_size = code_size + targets.size() * sizeof(ImportCounter);
+    void* region = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error("Failed to allocate import counters");
+    }
+    auto* code = static_cast<uint8_t*>(region);
+    auto* counters = reinterpret_cast<ImportCounter*>(code + code_size);
+
+    for (size_t i = 0; i < targets.size(); i++) {
+        counters[i] = { 0, targets[i] };
+        counted_imports[i].counter = &counters[i];
+
+        uint8_t* stub = code + i * IMPORT_STUB_SIZE;
+        int32_t count_disp = static_cast<int32_t>(reinterpret_cast<uint8_t*>(&counters[i].count) - (stub + 8));
+        int32_t target_disp = static_cast<int32_t>(reinterpret_cast<uint8_t*>(&counters[i].target) - (stub + 14));
+        const uint8_t lock_inc[] = { 0xf0, 0x48, 0xff, 0x05 };
+        const uint8_t jmp_mem[] = { 0xff, 0x25 };
+        memcpy(stub, lock_inc, sizeof(lock_inc));
+        memcpy(stub + 4, &count_disp, 4);
+        memcpy(stub + 8, jmp_mem, sizeof(jmp_mem));
+        memcpy(stub + 10, &target_disp, 4);
+        memset(stub + 14, 0xcc, IMPORT_STUB_SIZE - 14);
+    }
+    if (mprotect(region, code_size, PROT_READ | PROT_EXEC) != 0) {
+        throw std::runtime_error("Failed to protect import counting stubs");
+    }
+
+    for (const auto& slot : slots) {
+        *slot.addr = reinterpret_cast<uint64_t>(code + slot.import_index * IMPORT_STUB_SIZE);
+    }
+}
+
+// Print the call counts, most called first
+void print_import_counts()
+{
+    std::vector<const CountedImport*> sorted;
+    uint64_t total = 0;
+    for (const auto& import : counted_imports) {
+        sorted.push_back(&import);
+        total += import.counter->count;
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const CountedImport* a, const CountedImport* b) {
+        if (a->counter->count != b->counter->count) {
+            return a->counter->count > b->counter->count;
+        }
+        return a->name != b->name ? a->name < b->name : a->module < b->module;
+    });
+
+    std::cerr << "count-imports: " << sorted.size() << " imports, " << total << " calls" << std::endl;
+    for (const auto* import : sorted) {
+        std::cerr << std::setw(12) << import->counter->count << "  " << import->name
+                  << " (" << import->module << ")" << std::endl;
+    }
+}
+
+/**
+ * Fork off the program and report import counts once it exits
+ *
+ * Returns in the child, which goes on to run the program. The parent
+ * waits, prints the report and exits with the program's status.
+ */
+void run_with_import_report()
+{
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+    }
+    if (pid == 0) {
+        return;
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error(std::string("waitpid failed: ") + strerror(errno));
+        }
+    }
+    print_import_counts();
+    std::exit(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+}
+
+uint64_t monotonic_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void write_status(const std::string& line)
+{
+    size_t done = 0;
+    while (done < line.size()) {
+        ssize_t n = write(FORK_SERVER_STATUS_FD, line.data() + done, line.size() - done);
+        if (n < 0 && errno == EINTR) {
             continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error(std::string("fork server: status write failed: ") + strerror(errno));
+        }
+        done += n;
+    }
+}
 
-        void* target_addr = (void*)(mod.load_base + phdr.vaddr);
-        void* map_res = mmap(target_addr, phdr.size,
-            PROT_READ | PROT_WRITE, // Always RW initially for copying and relocation
-            MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+/**
+ * Serve run requests for an already loaded and relocated program
+ *
+ * Every line read from the control fd forks a child, which returns from
+ * here and jumps to the entry point. Each child starts from the state the
+ * loader left behind, since writable pages are copy-on-write: what one run
+ * writes is never seen by the next. The parent waits for the child and
+ * reports its exit status and wall time in microseconds. The server exits
+ * when the control fd reaches EOF.
+ */
+void run_fork_server(uint64_t load_start)
+{
+    if (fcntl(FORK_SERVER_CONTROL_FD, F_GETFD) < 0 || fcntl(FORK_SERVER_STATUS_FD, F_GETFD) < 0) {
+        throw std::runtime_error("fork server: control fd " + std::to_string(FORK_SERVER_CONTROL_FD)
+            + " and status fd " + std::to_string(FORK_SERVER_STATUS_FD) + " must be open");
+    }
+    // A client that goes away should end the server, not kill it
+    signal(SIGPIPE, SIG_IGN);
+    write_status("ready " + std::to_string(monotonic_us() - load_start) + "\n");
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::string pending;
+    char buf[256];
+    while (true) {
+        size_t newline = pending.find('\n');
+        if (newline == std::string::npos) {
+            ssize_t n = read(FORK_SERVER_CONTROL_FD, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                throw std::runtime_error(std::string("fork server: control read failed: ") + strerror(errno));
+            }
+            if (n == 0) {
+                std::exit(0);
+            }
+            pending.append(buf, n);
+            continue;
+        }
+        pending.erase(0, newline + 1);
 
-        if (map_res == MAP_FAILED) {
-            throw std::runtime_error("Failed to map segment " + phdr.name);
+        uint64_t start = monotonic_us();
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+        }
+        if (pid == 0) {
+            close(FORK_SERVER_CONTROL_FD);
+            close(FORK_SERVER_STATUS_FD);
+            signal(SIGPIPE, SIG_DFL);
+            return;
         }
 
-        // Copy section data
-        auto it = obj.sections.find(phdr.name);
-        if (it != obj.sections.end()) {
-            // Skip BSS copying
-            if (phdr.name != ".bss" && !starts_with(phdr.name, ".bss.")) {
-                if (it->second.data.size() > phdr.size) {
-                    // Should not happen if FLE is valid, but safety check
-                    memcpy(target_addr, it->second.data.data(), phdr.size);
-                } else {
-                    memcpy(target_addr, it->second.data.data(), it->second.data.size());
-                }
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0) {
+            if (errno != EINTR) {
+                throw std::runtime_error(std::string("waitpid failed: ") + strerror(errno));
             }
+        }
+        uint64_t elapsed = monotonic_us() - start;
+        if (WIFEXITED(status)) {
+            write_status(std::to_string(pid) + " exit " + std::to_string(WEXITSTATUS(status)) + " " + std::to_string(elapsed) + "\n");
         } else {
-            throw std::runtime_error("Section data not found for segment: " + phdr.name);
+            write_status(std::to_string(pid) + " signal " + std::to_string(WTERMSIG(status)) + " " + std::to_string(elapsed) + "\n");
         }
+    }
+}
+
+// Hardware events counted in user mode for --stats; user-mode only
+// counting is what an unprivileged process may do on its own children
+struct HardwareCounter {
+    const char* name;
+    uint64_t config;
+};
+
+constexpr HardwareCounter HARDWARE_COUNTERS[] = {
+    { "cycles", PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache misses", PERF_COUNT_HW_CACHE_MISSES },
+};
 
-        // Record section address
-        mod.section_addrs[phdr.name] = (uint64_t)target_addr;
+/**
+ * Open the hardware counters on a process that has not started yet
+ * @return One fd per HARDWARE_COUNTERS entry, or empty with error set
+ */
+std::vector<int> open_hardware_counters(pid_t pid, std::string& error)
+{
+    std::vector<int> fds;
+    for (const auto& counter : HARDWARE_COUNTERS) {
+        perf_event_attr attr {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = counter.config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // Follow the threads the program starts; inherited counters cannot
+        // use PERF_FORMAT_GROUP, so each event keeps its own fd
+        attr.inherit = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0) {
+            error = strerror(errno);
+            for (int open_fd : fds) {
+                close(open_fd);
+            }
+            return {};
+        }
+        fds.push_back(fd);
     }
+    return fds;
+}
 
-    // Add to specific list location (Global symbol resolution order)
-    loaded_modules.push_back(mod);
+// Final count of an event, scaled up if the PMU was shared with other events;
+// empty if the read failed or the event was never scheduled on the PMU
+std::optional<double> read_hardware_counter(int fd)
+{
+    uint64_t values[3] = {};
+    if (read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+        return std::nullopt;
+    }
+    return values[2] < values[1] ? static_cast<double>(values[0]) * values[1] / values[2] : values[0];
+}
 
-    // Recursively load dependencies
-    for (const auto& dep : obj.needed) {
-        load_module_recursive(dep);
+double median_of(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 != 0 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+struct StatsMetric {
+    std::string name;
+    int precision;
+    std::vector<double> samples;
+};
+
+/**
+ * Run the program options.runs times and report its resource usage
+ *
+ * Every run is a child forked from the loaded image, so each starts from
+ * the same state without reloading. A child waits on a pipe until the
+ * counters are attached, then returns from here to run the program. The
+ * parent collects rusage from wait4, prints the report to stderr and
+ * exits with the last run's status.
+ */
+void run_with_stats(const ExecOptions& options)
+{
+    if (options.pin_cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.pin_cpu, &cpus);
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+            throw std::runtime_error("cannot pin to CPU " + std::to_string(options.pin_cpu) + ": " + strerror(errno));
+        }
     }
+
+    std::vector<StatsMetric> metrics = {
+        { "wall time (ms)", 3, {} },
+        { "user time (ms)", 3, {} },
+        { "system time (ms)", 3, {} },
+        { "max RSS (KiB)", 0, {} },
+        { "minor faults", 0, {} },
+        { "major faults", 0, {} },
+        { "voluntary switches", 0, {} },
+        { "involuntary switches", 0, {} },
+    };
+    const size_t first_counter = metrics.size();
+    for (const auto& counter : HARDWARE_COUNTERS) {
+        metrics.push_back({ counter.name, 0, {} });
+    }
+    std::string counter_error;
+    int status = 0;
+
+    for (size_t run = 0; run < options.runs; run++) {
+        int sync[2];
+        if (pipe(sync) != 0) {
+            throw std::runtime_error(std::string("pipe failed: ") + strerror(errno));
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        uint64_t start = monotonic_us();
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+        }
+        if (pid == 0) {
+            close(sync[1]);
+            char go;
+            while (read(sync[0], &go, 1) < 0 && errno == EINTR) {
+            }
+            close(sync[0]);
+            return;
+        }
+
+        close(sync[0]);
+        std::vector<int> counters;
+        if (counter_error.empty()) {
+            counters = open_hardware_counters(pid, counter_error);
+        }
+        close(sync[1]);
+
+        rusage usage {};
+        while (wait4(pid, &status, 0, &usage) < 0) {
+            if (errno != EINTR) {
+                throw std::runtime_error(std::string("wait4 failed: ") + strerror(errno));
+            }
+        }
+        double wall = (monotonic_us() - start) / 1000.0;
+
+        auto ms = [](const timeval& tv) { return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0; };
+        double values[] = { wall, ms(usage.ru_utime), ms(usage.ru_stime), static_cast<double>(usage.ru_maxrss),
+            static_cast<double>(usage.ru_minflt), static_cast<double>(usage.ru_majflt),
+            static_cast<double>(usage.ru_nvcsw), static_cast<double>(usage.ru_nivcsw) };
+        for (size_t i = 0; i < first_counter; i++) {
+            metrics[i].samples.push_back(values[i]);
+        }
+        for (size_t i = 0; i < counters.size(); i++) {
+            if (std::optional<double> count = read_hardware_counter(counters[i])) {
+                metrics[first_counter + i].samples.push_back(*count);
+            }
+            close(counters[i]);
+        }
+    }
+
+    std::ostringstream report;
+    report << std::fixed;
+    report << "stats: " << options.runs << (options.runs == 1 ? " run" : " runs");
+    if (options.pin_cpu >= 0) {
+        report << " on CPU " << options.pin_cpu;
+    }
+    report << ", exit status " << (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status)) << "\n";
+    if (options.runs > 1) {
+        report << std::setw(24) << "" << std::setw(16) << "median" << std::setw(16) << "min" << std::setw(16) << "max" << "\n";
+    }
+    for (const auto& metric : metrics) {
+        report << "  " << std::left << std::setw(22) << metric.name << std::right;
+        // A counter that failed after the first runs is as unusable as a missing one
+        if (metric.samples.size() != options.runs && !counter_error.empty()) {
+            report << "  unavailable (" << counter_error << ")\n";
+            continue;
+        }
+        // Runs in which the event was never scheduled have no sample
+        if (metric.samples.empty()) {
+            report << std::setw(16) << "<not counted>" << "\n";
+            continue;
+        }
+        report << std::setprecision(metric.precision) << std::setw(16) << median_of(metric.samples);
+        if (options.runs > 1) {
+            auto [min, max] = std::minmax_element(metric.samples.begin(), metric.samples.end());
+            report << std::setw(16) << *min << std::setw(16) << *max;
+        }
+        if (metric.samples.size() != options.runs) {
+            report << "  (counted in " << metric.samples.size() << " of " << options.runs << " runs)";
+        }
+        report << "\n";
+    }
+    std::cerr << report.str() << std::flush;
+    std::exit(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+}
+
+// Serializes service calls, which all run on the one loader TLS
+std::atomic_flag service_lock = ATOMIC_FLAG_INIT;
+std::string service_error; // Pending message for dlerror
+std::string reported_error; // Message last returned by dlerror
+
+/**
+ * Run a service call made by the program
+ *
+ * The program calls in with its own thread pointer in FS, so the loader's
+ * TLS (errno, exception state, ...) is switched in for the duration and
+ * the program's is restored afterwards. Only a spin lock is taken before
+ * the switch, because pthread locks read the thread pointer. An exception
+ * becomes a null result, with its message kept for dlerror.
+ */
+template <typename Fn>
+void* run_service(Fn&& fn)
+{
+    while (service_lock.test_and_set(std::memory_order_acquire)) {
+    }
+    uint64_t program_thread_pointer;
+    asm volatile("mov %%fs:0, %0" : "=r"(program_thread_pointer));
+    set_thread_pointer(loader_thread_pointer);
+
+    void* result = nullptr;
+    try {
+        result = fn();
+    } catch (const std::exception& e) {
+        service_error = e.what();
+    }
+
+    set_thread_pointer(program_thread_pointer);
+    service_lock.clear(std::memory_order_release);
+    return result;
+}
+
+// Drop modules [first, end) after a failed dlopen
+void unload_modules_from(size_t first)
+{
+    for (size_t i = first; i < loaded_modules.size(); i++) {
+        const auto& mod = loaded_modules[i];
+        if (mod.map_size != 0) {
+            munmap(reinterpret_cast<void*>(mod.map_start), mod.map_size);
+        }
+        loaded_module_names.erase(mod.name);
+        // Its parsed object was consumed; read it again if it is asked for
+        scanned_names.erase(mod.name);
+    }
+    loaded_modules.erase(loaded_modules.begin() + first, loaded_modules.end());
+}
+
+/**
+ * Load a shared library and its dependencies while the program runs
+ *
+ * New modules join the end of the global search order, so they can use
+ * everything loaded before them but never take over existing bindings.
+ * A handle is the module's index plus one; loading the same name again
+ * returns the same handle.
+ */
+void* service_dlopen(const char* name)
+{
+    return run_service([&]() -> void* {
+        if (name == nullptr) {
+            throw std::runtime_error("dlopen: null library name");
+        }
+        std::string filename = name;
+        for (size_t i = 0; i < loaded_modules.size(); i++) {
+            if (loaded_modules[i].name == filename) {
+                return reinterpret_cast<void*>(i + 1);
+            }
+        }
+        // An executable would be mapped over the running program
+        if (!scanned_objects.count(filename)) {
+            scanned_objects[filename] = load_fle_with_path(filename);
+            scanned_names.erase(filename);
+        }
+        if (scanned_objects[filename].type != ".so") {
+            scanned_objects.erase(filename);
+            throw std::runtime_error("dlopen: " + filename + " is not a shared library");
+        }
+
+        size_t first = loaded_modules.size();
+        try {
+            scan_dependencies_recursive(filename);
+            load_module_recursive(filename);
+            for (size_t i = first; i < loaded_modules.size(); i++) {
+                relocate_module(loaded_modules[i]);
+            }
+            for (size_t i = first; i < loaded_modules.size(); i++) {
+                protect_module(loaded_modules[i]);
+            }
+        } catch (...) {
+            unload_modules_from(first);
+            throw;
+        }
+        return reinterpret_cast<void*>(first + 1);
+    });
+}
+
+// Address of a symbol defined in the handle's module, or in any module for a null handle
+void* service_dlsym(void* handle, const char* name)
+{
+    return run_service([&]() -> void* {
+        if (name == nullptr) {
+            throw std::runtime_error("dlsym: null symbol name");
+        }
+        if (handle == nullptr) {
+            return reinterpret_cast<void*>(resolve_symbol(name));
+        }
+        size_t index = reinterpret_cast<uintptr_t>(handle) - 1;
+        if (index >= loaded_modules.size()) {
+            throw std::runtime_error("dlsym: invalid handle");
+        }
+        const auto& mod = loaded_modules[index];
+        auto it = mod.exports.find(name);
+        if (it != mod.exports.end()) {
+            return reinterpret_cast<void*>(it->second.addr);
+        }
+        throw std::runtime_error("dlsym: " + std::string(name) + " not found in " + mod.name);
+    });
+}
+
+// Message of the last failed call, then null until the next failure
+const char* service_dlerror()
+{
+    return static_cast<const char*>(run_service([]() -> void* {
+        if (service_error.empty()) {
+            return nullptr;
+        }
+        reported_error = std::move(service_error);
+        service_error.clear();
+        return reported_error.data();
+    }));
 }
 
 } // namespace
 
-void FLE_exec(const FLEObject& obj)
+void FLE_exec_restore_tls()
+{
+    if (loader_thread_pointer != 0) {
+        set_thread_pointer(loader_thread_pointer);
+    }
+}
+
+bool FLE_exec_symbolize(uint64_t addr, char* buf, size_t size)
 {
+    const LoadedModule* mod = module_at(addr);
+    if (mod == nullptr) {
+        return false;
+    }
+    const SymbolIndexEntry* entry = mod->symbol_index.lookup(addr - mod->load_base);
+    if (entry == nullptr) {
+        return false;
+    }
+    snprintf(buf, size, "%s+0x%llx (%s)", mod->symbol_index.names[entry->name].c_str(),
+        static_cast<unsigned long long>(addr - mod->load_base - entry->start), mod->name.c_str());
+    return true;
+}
+
+void FLE_exec(FLEObject input, const ExecOptions& options)
+{
+    // A bundle supplies the executable and every library it needs
+    bundle_members.clear();
+    bundle_bindings = nullptr;
+    if (input.type == ".bundle") {
+        if (input.members.empty()) {
+            throw std::runtime_error("Bundle has no members.");
+        }
+        for (size_t i = 1; i < input.members.size(); i++) {
+            bundle_members[input.members[i].name] = &input.members[i];
+        }
+    }
+    FLEObject& obj = input.type == ".bundle" ? input.members[0] : input;
+
     if (obj.type != ".exe") {
         throw std::runtime_error("File is not an executable FLE.");
     }
+    if (options.count_imports + options.fork_server + options.stats > 1) {
+        throw std::runtime_error("--count-imports, --fork-server and --stats cannot be combined");
+    }
+    uint64_t load_start = monotonic_us();
 
     // Clear globals for fresh execution
     loaded_modules.clear();
     loaded_module_names.clear();
     scanned_names.clear();
+    scanned_objects.clear();
     need_low_address = false;
+    address_plan = {};
+
+    const std::vector<std::string> preloads = preload_libraries();
 
     // Pre-scan all dependencies to check if any SO has PC32 dyn_relocs
     // This must be done BEFORE loading so we know whether to use MAP_32BIT
+    for (const auto& dep : preloads) {
+        scan_dependencies_recursive(dep);
+        // Checked before anything is mapped: an executable would land on top of ours
+        auto scanned = scanned_objects.find(dep);
+        if (scanned != scanned_objects.end() && scanned->second.type != ".so") {
+            throw std::runtime_error("FLE_PRELOAD: " + dep + " is not a shared library");
+        }
+    }
     for (const auto& dep : obj.needed) {
         scan_dependencies_recursive(dep);
     }
+    // The main executable's own PC32 text relocations must reach its libraries too
+    if ((!obj.needed.empty() || !preloads.empty()) && has_pc32_dyn_relocs(obj)) {
+        need_low_address = true;
+    }
 
     // 1. Load Main Executable (Manual setup for the main object provided)
     // We treat the passed object as the first module but we need its name.
@@ -331,156 +1336,207 @@ void FLE_exec(const FLEObject& obj)
 
     LoadedModule main_mod;
     main_mod.name = obj.name.empty() ? "main" : obj.name;
-    main_mod.obj = obj;
     main_mod.load_base = 0;
+    map_module(main_mod, obj);
 
-    // Map Main Executable segments
-    for (const auto& phdr : obj.phdrs) {
-        if (phdr.size == 0)
-            continue;
-
-        void* addr = mmap((void*)phdr.vaddr, phdr.size,
-            PROT_READ | PROT_WRITE, // RW for relocations
-            MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
-
-        if (addr == MAP_FAILED) {
-            throw std::runtime_error(std::string("mmap failed: ") + strerror(errno));
-        }
-
-        auto it = obj.sections.find(phdr.name);
-        if (it == obj.sections.end()) {
-            throw std::runtime_error("Section not found: " + phdr.name);
-        }
+    loaded_module_names.insert(main_mod.name);
+    loaded_modules.push_back(std::move(main_mod));
 
-        if (phdr.name != ".bss" && !starts_with(phdr.name, ".bss.")) {
-            memcpy(addr, it->second.data.data(), phdr.size);
+    // Reserve room for every library up front, right above the executable
+    for (const auto& phdr : obj.phdrs) {
+        if (phdr.size != 0) {
+            address_plan.exe_start = address_plan.exe_end == 0 ? phdr.vaddr : std::min(address_plan.exe_start, phdr.vaddr);
+            address_plan.exe_end = std::max(address_plan.exe_end, phdr.vaddr + phdr.size);
         }
-
-        main_mod.section_addrs[phdr.name] = phdr.vaddr;
     }
+    std::vector<std::string> roots = preloads;
+    roots.insert(roots.end(), obj.needed.begin(), obj.needed.end());
+    plan_address_space(roots);
 
-    loaded_modules.push_back(main_mod);
-    loaded_module_names.insert(main_mod.name);
+    // Preloaded libraries come before main's own dependencies in the search order
+    for (const auto& dep : preloads) {
+        load_module_recursive(dep);
+    }
 
     // Load dependencies of main
     for (const auto& dep : obj.needed) {
         load_module_recursive(dep);
     }
+    // Libraries loaded from now on get ranges of their own
+    address_plan.next = address_plan.end;
+
+    // The bundle's bindings hold as long as nothing was loaded out of its order
+    if (input.type == ".bundle" && loaded_modules.size() == input.members.size()) {
+        bool same_order = true;
+        for (size_t i = 1; i < loaded_modules.size(); i++) {
+            same_order = same_order && loaded_modules[i].name == input.members[i].name;
+        }
+        if (same_order) {
+            bundle_bindings = &input.bindings;
+        }
+    }
+    // Members loaded at startup are never read again
+    for (const auto& mod : loaded_modules) {
+        auto it = bundle_members.find(mod.name);
+        if (it != bundle_members.end()) {
+            release_contents(*it->second);
+            bundle_members.erase(it);
+        }
+    }
 
     // 2. Perform Relocations for ALL modules
     for (auto& mod : loaded_modules) {
+        relocate_module(mod);
+    }
 
-        // A. Dynamic Relocations (Bonus 1 - Text Relocations for SO, Bonus 2 - GOT for EXE)
-        // For .so: dyn_relocs.offset is relative to merged section data (typically .text)
-        // For .exe: dyn_relocs.offset is VMA (already resolved during linking)
-        for (const auto& reloc : mod.obj.dyn_relocs) {
-            uint64_t reloc_addr;
-
-            if (mod.obj.type == ".exe") {
-                // For executables, offset is the VMA
-                reloc_addr = reloc.offset;
-            } else {
-                // For shared objects, offset is VMA relative to Load Base
-                reloc_addr = mod.load_base + reloc.offset;
-            }
-
-            uint64_t sym_addr = resolve_symbol(reloc.symbol);
-
-            switch (reloc.type) {
-            case RelocationType::R_X86_64_64:
-                *(uint64_t*)reloc_addr = sym_addr + reloc.addend;
-                break;
-            case RelocationType::R_X86_64_32:
-                *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend);
-                break;
-            case RelocationType::R_X86_64_32S:
-                *(int32_t*)reloc_addr = (int32_t)(sym_addr + reloc.addend);
-                break;
-            case RelocationType::R_X86_64_PC32:
-                // S + A - P
-                *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend - reloc_addr);
-                break;
-            case RelocationType::R_X86_64_GOTPCREL:
-                *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend - reloc_addr);
-                break;
-            }
+    // C. Copy Relocations
+    // The executable holds its own copy of library data it accesses directly.
+    // Take the initial value from the defining library, skipping the executable
+    // itself, now that the library's data has been relocated; every other
+    // reference already resolved to the copy, since the executable is searched first
+    for (const auto& reloc : loaded_modules[0].dyn_relocs) {
+        if (reloc.type != RelocationType::R_X86_64_COPY) {
+            continue;
         }
+        const ExportedSymbol* def = nullptr;
+        uint64_t src = resolve_symbol(reloc.symbol, 1, &def);
+        memcpy(reinterpret_cast<void*>(reloc.offset), reinterpret_cast<const void*>(src), def->size);
+    }
 
-        // B. Section Relocations (Bonus 1 - Text Relocations)
-        // Iterate over sections to find relocations
-        for (const auto& kv : mod.obj.sections) {
-            const auto& name = kv.first;
-            const auto& section = kv.second;
-
-            // Check if this section is loaded.
-            auto addr_it = mod.section_addrs.find(name);
-            if (addr_it == mod.section_addrs.end())
-                continue;
-
-            // In FLE, section relocs have offset relative to the section start
-            // phdr.vaddr corresponds to the section start VMA relative to Load Base (for SO) or Absolute (for EXE)
-            // Wait, for .so, phdr.vaddr is offset from base.
-            // But we stored the Absolute Runtime Address in section_addrs.
-            // But apply_reloc adds load_base + section_base ...
-
-            // Let's adjust logic.
-            // For Main (.exe), load_base = 0. section_addr is absolute.
-            // For .so, load_base = allocated. section_addr is absolute = load_base + vaddr.
-
-            // Reloc offset is relative to section start.
-            // address = section_absolute_start + reloc.offset.
-            // We can pass `section_absolute_start - load_base` as 2nd arg?
-            // Or just calculate address and adapt lambda.
-
-            uint64_t section_runtime_addr = addr_it->second;
-
-            for (const auto& reloc : section.relocs) {
-                uint64_t sym_addr = resolve_symbol(reloc.symbol);
-                uint64_t reloc_addr = section_runtime_addr + reloc.offset;
-
-                switch (reloc.type) {
-                case RelocationType::R_X86_64_64:
-                    *(uint64_t*)reloc_addr = sym_addr + reloc.addend;
-                    break;
-                case RelocationType::R_X86_64_32:
-                    *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend);
-                    break;
-                case RelocationType::R_X86_64_32S:
-                    *(int32_t*)reloc_addr = (int32_t)(sym_addr + reloc.addend);
-                    break;
-                case RelocationType::R_X86_64_PC32:
-                    *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend - reloc_addr);
-                    break;
-                case RelocationType::R_X86_64_GOTPCREL:
-                    *(uint32_t*)reloc_addr = (uint32_t)(sym_addr + reloc.addend - reloc_addr);
-                    break;
-                }
-            }
-        }
+    // D. Counting stubs for --count-imports; nothing is installed otherwise,
+    // so ordinary runs call through the GOT directly
+    if (options.count_imports) {
+        install_import_counters();
     }
 
     // 3. Set Permissions (after all relocations are done)
     for (const auto& mod : loaded_modules) {
-        for (const auto& phdr : mod.obj.phdrs) {
-            if (phdr.size == 0)
-                continue;
+        protect_module(mod);
+    }
 
-            // Find runtime address
-            uint64_t addr = mod.load_base + phdr.vaddr;
+    // 4. Static TLS block of the initial thread
+    uint64_t thread_pointer = setup_initial_tls(obj);
 
-            mprotect((void*)addr, phdr.size,
-                (phdr.flags & PHF::R ? PROT_READ : 0)
-                    | (phdr.flags & PHF::W ? PROT_WRITE : 0)
-                    | (phdr.flags & PHF::X ? PROT_EXEC : 0));
-        }
+    if (options.count_imports) {
+        run_with_import_report();
+    }
+    if (options.fork_server) {
+        run_fork_server(load_start);
+    }
+    if (options.stats) {
+        run_with_stats(options);
     }
 
-    // 4. Jump to Entry
+    // 5. Jump to Entry
     using FuncType = int (*)();
     // Entry is VMA. Main EXE base is 0. So entry is absolute.
     FuncType func = reinterpret_cast<FuncType>(obj.entry);
+
+    // From here on the loader's own TLS (errno, ...) is unreachable,
+    // so switch FS last
+    asm volatile("mov %%fs:0, %0" : "=r"(loader_thread_pointer));
+    if (set_thread_pointer(thread_pointer) != 0) {
+        abort();
+    }
     func();
 
     // Should not reach here
     assert(false);
 }
+
+void FLE_bundle(const std::string& output, const std::string& program)
+{
+    // Read a member's JSON as written, without the "#!" line of executables
+    auto read_member = [](const std::string& path, const std::string& name) {
+        std::ifstream in(path);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (content.substr(0, 2) == "#!") {
+            content = content.substr(content.find('\n') + 1);
+        }
+        json member = json::parse(content);
+        member["name"] = name;
+        return member;
+    };
+
+    FLEObject main_obj = load_fle(program);
+    if (main_obj.type != ".exe") {
+        throw std::runtime_error(program + " is not an executable FLE.");
+    }
+
+    // Same depth-first order as load_module_recursive
+    std::vector<FLEObject> modules { main_obj };
+    json members = json::array({ read_member(program, get_basename(program)) });
+    std::unordered_set<std::string> seen;
+    std::function<void(const std::string&)> add = [&](const std::string& name) {
+        if (!seen.insert(name).second) {
+            return;
+        }
+        std::string path = find_fle_file(name);
+        modules.push_back(load_fle(path));
+        members.push_back(read_member(path, name));
+        std::vector<std::string> needed = modules.back().needed;
+        for (const auto& dep : needed) {
+            add(dep);
+        }
+    };
+    for (const auto& dep : main_obj.needed) {
+        add(dep);
+    }
+
+    // Bind every import to its first definition in load order, as resolve_symbol does
+    auto loaded_sections = [](const FLEObject& obj) {
+        std::unordered_set<std::string> names;
+        for (const auto& phdr : obj.phdrs) {
+            if (phdr.size != 0) {
+                names.insert(phdr.name);
+            }
+        }
+        return names;
+    };
+    std::vector<std::unordered_set<std::string>> sections;
+    for (const auto& mod : modules) {
+        sections.push_back(loaded_sections(mod));
+    }
+    auto bind = [&](const std::string& name) -> json {
+        for (size_t i = 0; i < modules.size(); i++) {
+            for (const auto& sym : modules[i].symbols) {
+                if (sym.name == name && (sym.type == SymbolType::GLOBAL || sym.type == SymbolType::WEAK)
+                    && sections[i].count(sym.section)) {
+                    return { i, sym.section, sym.offset };
+                }
+            }
+        }
+        throw std::runtime_error("bundle: undefined symbol " + name);
+    };
+
+    json bindings = json::object();
+    for (const auto& mod : modules) {
+        std::vector<const Relocation*> relocs;
+        for (const auto& reloc : mod.dyn_relocs) {
+            relocs.push_back(&reloc);
+        }
+        for (const auto& [name, section] : mod.sections) {
+            for (const auto& reloc : section.relocs) {
+                relocs.push_back(&reloc);
+            }
+        }
+        for (const Relocation* reloc : relocs) {
+            if (reloc->type != RelocationType::R_X86_64_COPY && !bindings.contains(reloc->symbol)) {
+                bindings[reloc->symbol] = bind(reloc->symbol);
+            }
+        }
+    }
+
+    json bundle;
+    bundle["type"] = ".bundle";
+    bundle["name"] = get_basename(output);
+    bundle["members"] = members;
+    bundle["bindings"] = bindings;
+    std::ofstream out(output);
+    out << bundle.dump(4) << std::endl;
+    if (!out) {
+        throw std::runtime_error("Failed to write " + output);
+    }
+    std::cerr << "bundle: " << output << ": " << modules.size() << " modules, "
+              << bindings.size() << " bound imports" << std::endl;
+}
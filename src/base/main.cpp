@@ -1,14 +1,30 @@
 #include "argparse.hpp"
 #include "fle.hpp"
+#include "parallel.hpp"
 #include "string_utils.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <csignal>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <execinfo.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
@@ -16,6 +32,8 @@ using namespace std::string_literals;
 
 void segv_handler(int sig, siginfo_t* si, void* ctx)
 {
+    // 程序可能已接管 FS，先切回加载器自己的 TLS 再调用 libc
+    FLE_exec_restore_tls();
     fprintf(stderr, "Caught SIGSEGV at address: %p\n", si->si_addr);
     fflush(stderr);
     fprintf(stderr, "Error code: %d\n", si->si_code);
@@ -38,6 +56,10 @@ void segv_handler(int sig, siginfo_t* si, void* ctx)
     }
 
     fprintf(stderr, "Instruction at: %p\n", reinterpret_cast<void*>(rip));
+    char where[256];
+    if (FLE_exec_symbolize(rip, where, sizeof(where))) {
+        fprintf(stderr, "In function: %s\n", where);
+    }
     fflush(stderr);
     // call_site_next 是 call 指令推入的“返回地址”，即 call 指令自身之后的那条指令地址
     // 它通常比 call 指令的开头多 5~7 个字节（具体看是否是 call rel32 或 call r/m64 等）
@@ -89,6 +111,7 @@ static void parse_section_headers(const json& j, FLEObject& obj)
             shdr.addr = shdr_json["addr"].get<uint64_t>();
             shdr.offset = shdr_json["offset"].get<uint64_t>();
             shdr.size = shdr_json["size"].get<uint64_t>();
+            shdr.align = shdr_json.value("align", uint64_t(1));
             obj.shdrs.push_back(shdr);
         }
     }
@@ -107,6 +130,12 @@ static RelocationType parse_relocation_type(const std::string& type_str)
         return RelocationType::R_X86_64_32S;
     if (type_str == "gotpcrel")
         return RelocationType::R_X86_64_GOTPCREL;
+    if (type_str == "tpoff32")
+        return RelocationType::R_X86_64_TPOFF32;
+    if (type_str == "gottpoff")
+        return RelocationType::R_X86_64_GOTTPOFF;
+    if (type_str == "dyncopy")
+        return RelocationType::R_X86_64_COPY;
     throw std::runtime_error("Invalid relocation type: " + type_str);
 }
 static int64_t parse_addend_literal(std::string literal)
@@ -129,7 +158,7 @@ static int64_t parse_addend_literal(std::string literal)
 
 
 
-static FLEObject parse_fle_from_json(const json& j, const std::string& name)
+static FLEObject parse_fle_from_json(const json& j, const std::string& name, bool metadata_only)
 {
     FLEObject obj;
     obj.name = name;
@@ -142,7 +171,24 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
                 if (member_json.contains("name")) {
                     member_name = member_json["name"].get<std::string>();
                 }
-                obj.members.push_back(parse_fle_from_json(member_json, member_name));
+                obj.members.push_back(parse_fle_from_json(member_json, member_name, metadata_only));
+            }
+        }
+        return obj;
+    }
+
+    // 打包文件：成员按加载顺序排列，第一个是可执行文件
+    if (obj.type == ".bundle") {
+        for (const auto& member_json : j["members"]) {
+            obj.members.push_back(parse_fle_from_json(member_json, member_json["name"].get<std::string>(), metadata_only));
+        }
+        if (j.contains("bindings")) {
+            for (const auto& [symbol, binding] : j["bindings"].items()) {
+                size_t member = binding[0].get<size_t>();
+                if (member >= obj.members.size()) {
+                    throw std::runtime_error("bundle binding of " + symbol + " refers to missing member #" + std::to_string(member));
+                }
+                obj.bindings[symbol] = { member, binding[1].get<std::string>(), binding[2].get<uint64_t>() };
             }
         }
         return obj;
@@ -168,6 +214,18 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
         }
     }
 
+    if (j.contains("symbol_index")) {
+        const json& index = j["symbol_index"];
+        obj.symbol_index.names = index["names"].get<std::vector<std::string>>();
+        for (const auto& entry : index["entries"]) {
+            uint32_t name_id = entry[2].get<uint32_t>();
+            if (name_id >= obj.symbol_index.names.size()) {
+                throw std::runtime_error("symbol index refers to missing name #" + std::to_string(name_id));
+            }
+            obj.symbol_index.entries.push_back({ entry[0].get<uint64_t>(), entry[1].get<uint64_t>(), name_id });
+        }
+    }
+
     std::vector<Relocation> legacy_dyn_relocs;
     std::vector<Relocation> inline_dyn_relocs;
 
@@ -185,7 +243,7 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
 
     // 第一遍：收集所有符号定义并计算偏移量
     for (auto& [key, value] : j.items()) {
-        if (key == "type" || key == "entry" || key == "phdrs" || key == "shdrs" || key == "members" || key == "name" || key == "needed" || key == "dyn_relocs")
+        if (key == "type" || key == "entry" || key == "phdrs" || key == "shdrs" || key == "members" || key == "name" || key == "needed" || key == "dyn_relocs" || key == "symbol_index")
             continue;
 
         // size_t current_offset = 0;
@@ -221,7 +279,7 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
 
     // 第二遍：处理节的内容和重定位
     for (auto& [key, value] : j.items()) {
-        if (key == "type" || key == "entry" || key == "phdrs" || key == "shdrs" || key == "members" || key == "name" || key == "needed" || key == "dyn_relocs")
+        if (key == "type" || key == "entry" || key == "phdrs" || key == "shdrs" || key == "members" || key == "name" || key == "needed" || key == "dyn_relocs" || key == "symbol_index")
             continue;
 
         FLESection section;
@@ -234,6 +292,10 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
             std::string content = line_str.substr(colon_pos + 1);
 
             if (prefix == "🔢") {
+                // 只需要符号和重定位时不解码节内容
+                if (metadata_only) {
+                    continue;
+                }
                 std::stringstream ss(content);
                 uint32_t byte;
                 while (ss >> std::hex >> byte) {
@@ -241,7 +303,7 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
                 }
             } else if (prefix == "❓") {
                 std::string reloc_str = trim(content);
-                std::regex reloc_pattern(R"(\.(rel|abs64|abs|abs32s|gotpcrel|dynrel|dynabs64|dynabs32)\(([\w.@$]+)\s*([-+])\s*([0-9a-fA-FxX]+)\))");
+                std::regex reloc_pattern(R"(\.(rel|abs64|abs|abs32s|gotpcrel|tpoff32|gottpoff|dynrel|dynabs64|dynabs32|dyncopy)\(([\w.@$]+)\s*([-+])\s*([0-9a-fA-FxX]+)\))");
                 std::smatch match;
 
                 if (!std::regex_match(reloc_str, match, reloc_pattern)) {
@@ -289,8 +351,7 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
 
                     inline_dyn_relocs.push_back(reloc);
 
-                    size_t size = (type == RelocationType::R_X86_64_64) ? 8 : 4;
-                    section.data.insert(section.data.end(), size, 0);
+                    section.data.insert(section.data.end(), relocation_size(type), 0);
                     continue;
                 }
 
@@ -306,14 +367,42 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
                 section.relocs.push_back(reloc);
 
                 // 根据重定位类型预留空间
-                size_t size = (type == RelocationType::R_X86_64_64) ? 8 : 4;
-                section.data.insert(section.data.end(), size, 0);
+                section.data.insert(section.data.end(), relocation_size(type), 0);
             } else if (prefix == "🏷️" || prefix == "📎" || prefix == "📤") {
                 section.has_symbols = true;
             }
         }
 
         section.name = key;
+        section.size = section.data.size();
+
+        // NOBITS 节只记录大小，内容全为零，不在内存中展开
+        auto shdr_it = std::find_if(obj.shdrs.begin(), obj.shdrs.end(), [&](const SectionHeader& shdr) {
+            return shdr.name == key;
+        });
+        auto phdr_it = std::find_if(obj.phdrs.begin(), obj.phdrs.end(), [&](const ProgramHeader& phdr) {
+            return phdr.name == key;
+        });
+        if (shdr_it != obj.shdrs.end()) {
+            section.nobits = shdr_it->flags & SHF::NOBITS;
+            if (section.nobits) {
+                section.size = std::max<size_t>(section.size, shdr_it->size);
+            }
+        } else if (key.rfind(".bss", 0) == 0 || key.rfind(".tbss", 0) == 0) {
+            // 没有节头的旧文件和可执行文件按节名判断，可执行文件的大小记录在程序头中
+            section.nobits = true;
+            if (phdr_it != obj.phdrs.end()) {
+                section.size = std::max<size_t>(section.size, phdr_it->size);
+            }
+        }
+        if (section.nobits) {
+            if (!section.relocs.empty()) {
+                throw std::runtime_error("NOBITS section " + key + " has relocations");
+            }
+            section.data.clear();
+            section.data.shrink_to_fit();
+        }
+
         obj.sections[key] = section;
     }
 
@@ -326,7 +415,7 @@ static FLEObject parse_fle_from_json(const json& j, const std::string& name)
     return obj;
 }
 
-FLEObject load_fle(const std::string& file)
+FLEObject load_fle(const std::string& file, bool metadata_only)
 {
     std::ifstream infile(file);
     std::string content((std::istreambuf_iterator<char>(infile)),
@@ -337,7 +426,7 @@ FLEObject load_fle(const std::string& file)
     }
 
     json j = json::parse(content);
-    return parse_fle_from_json(j, get_basename(file));
+    return parse_fle_from_json(j, get_basename(file), metadata_only);
 }
 
 /**
@@ -430,12 +519,952 @@ void FLE_ar(const std::vector<std::string>& args)
     out << ar_json.dump(4) << std::endl;
 }
 
+/**
+ * 比较两次链接的结果，返回第一处差异的描述；完全相同时返回空串
+ */
+static std::string first_link_difference(const FLEObject& a, const FLEObject& b)
+{
+    if (a.type != b.type || a.entry != b.entry) {
+        return "file type or entry point";
+    }
+    if (a.needed != b.needed) {
+        return "needed list";
+    }
+
+    for (const auto& [name, sec_a] : a.sections) {
+        auto it = b.sections.find(name);
+        if (it == b.sections.end()) {
+            return "section " + name + " missing from multithreaded output";
+        }
+        const FLESection& sec_b = it->second;
+        size_t common = std::min(sec_a.data.size(), sec_b.data.size());
+        for (size_t i = 0; i < common; i++) {
+            if (sec_a.data[i] != sec_b.data[i]) {
+                char buf[128];
+                snprintf(buf, sizeof(buf), " differs at offset 0x%zx (0x%02x vs 0x%02x)", i, sec_a.data[i], sec_b.data[i]);
+                return "section " + name + buf;
+            }
+        }
+        if (sec_a.data.size() != sec_b.data.size()) {
+            return "section " + name + " size " + std::to_string(sec_a.data.size()) + " vs " + std::to_string(sec_b.data.size());
+        }
+        if (sec_a.relocs.size() != sec_b.relocs.size()) {
+            return "relocation count of section " + name;
+        }
+        for (size_t i = 0; i < sec_a.relocs.size(); i++) {
+            const Relocation& ra = sec_a.relocs[i];
+            const Relocation& rb = sec_b.relocs[i];
+            if (ra.type != rb.type || ra.offset != rb.offset || ra.symbol != rb.symbol || ra.addend != rb.addend) {
+                return "relocation #" + std::to_string(i) + " of section " + name;
+            }
+        }
+    }
+    if (a.sections.size() != b.sections.size()) {
+        return "section list";
+    }
+
+    if (a.symbols.size() != b.symbols.size()) {
+        return "symbol count";
+    }
+    for (size_t i = 0; i < a.symbols.size(); i++) {
+        const Symbol& sa = a.symbols[i];
+        const Symbol& sb = b.symbols[i];
+        if (sa.type != sb.type || sa.section != sb.section || sa.offset != sb.offset || sa.size != sb.size || sa.name != sb.name) {
+            return "symbol #" + std::to_string(i) + " (" + sa.name + " vs " + sb.name + ")";
+        }
+    }
+
+    if (a.symbol_index.names != b.symbol_index.names || a.symbol_index.entries.size() != b.symbol_index.entries.size()) {
+        return "symbol index";
+    }
+    for (size_t i = 0; i < a.symbol_index.entries.size(); i++) {
+        const SymbolIndexEntry& ea = a.symbol_index.entries[i];
+        const SymbolIndexEntry& eb = b.symbol_index.entries[i];
+        if (ea.start != eb.start || ea.size != eb.size || ea.name != eb.name) {
+            return "symbol index entry #" + std::to_string(i);
+        }
+    }
+
+    if (a.phdrs.size() != b.phdrs.size() || a.shdrs.size() != b.shdrs.size()) {
+        return "program or section headers";
+    }
+    for (size_t i = 0; i < a.phdrs.size(); i++) {
+        const ProgramHeader& pa = a.phdrs[i];
+        const ProgramHeader& pb = b.phdrs[i];
+        if (pa.name != pb.name || pa.vaddr != pb.vaddr || pa.size != pb.size || pa.flags != pb.flags) {
+            return "program header " + pa.name;
+        }
+    }
+    for (size_t i = 0; i < a.shdrs.size(); i++) {
+        const SectionHeader& ha = a.shdrs[i];
+        const SectionHeader& hb = b.shdrs[i];
+        if (ha.name != hb.name || ha.addr != hb.addr || ha.offset != hb.offset || ha.size != hb.size || ha.flags != hb.flags) {
+            return "section header " + ha.name;
+        }
+    }
+
+    if (a.dyn_relocs.size() != b.dyn_relocs.size()) {
+        return "dynamic relocation count";
+    }
+    for (size_t i = 0; i < a.dyn_relocs.size(); i++) {
+        const Relocation& ra = a.dyn_relocs[i];
+        const Relocation& rb = b.dyn_relocs[i];
+        if (ra.type != rb.type || ra.offset != rb.offset || ra.symbol != rb.symbol || ra.addend != rb.addend) {
+            return "dynamic relocation #" + std::to_string(i);
+        }
+    }
+    return "";
+}
+
 struct InputItem {
     enum Type { File,
         Library } type;
     std::string value;
+    bool as_needed = false; // 出现在 --as-needed 之后、--no-as-needed 之前
+};
+
+/**
+ * 一次 ld 调用的命令行解析结果
+ */
+struct LdCommand {
+    LinkerOptions options;
+    std::vector<std::string> input_paths; // 按命令行顺序，-l 已解析为库文件路径
+    bool verify_determinism = false;
+    bool check_only = false;
+    std::string batch_manifest; // --batch 清单文件
+    std::string server_socket; // --server：在该 Unix 套接字上提供链接服务
+    size_t server_cache_entries = 256; // --server-cache-entries：服务器最多缓存的输入文件数
+    std::string connect_socket; // --connect：把命令行转发给该套接字上的服务器
+    bool stop_server = false; // --stop-server：与 --connect 一起使用，让服务器退出
+    std::string link_cache; // --link-cache：整次链接结果的缓存目录
+    size_t threads = 0; // 并行阶段使用的线程数 (--threads)，0 表示每个硬件线程一个
+    bool threads_given = false; // 命令行中出现了 --threads
+};
+
+/**
+ * 解析 ld 的命令行并查找 -l 指定的库
+ * @throw ArgParser::HelpRequested 如果请求了帮助
+ * @throw std::runtime_error 如果参数无效或找不到库
+ */
+static LdCommand parse_ld_command(const std::vector<std::string>& args)
+{
+    LdCommand cmd;
+    LinkerOptions& options = cmd.options;
+    std::vector<InputItem> ordered_inputs;
+    std::vector<std::string> lib_paths;
+    bool as_needed = false;
+
+    ArgParser parser("ld");
+
+    parser.add_option(options.outputFile, "-o, --output", "Output file");
+    parser.add_option(options.entryPoint, "-e, --entry", "Entry point");
+    parser.add_flag(options.shared, "-shared", "Create shared library");
+    parser.add_flag(options.is_static, "-static", "Static linking");
+    parser.add_multi_option(lib_paths, "-L", "Add library search path");
+    parser.add_option_cb("-T, --script", "Use linker script for output layout", [&](std::string path) {
+        std::ifstream script_file(path);
+        if (!script_file) {
+            throw std::runtime_error("cannot open linker script " + path);
+        }
+        options.script.assign(std::istreambuf_iterator<char>(script_file), std::istreambuf_iterator<char>());
+    });
+    parser.add_option_cb("--section-start", "Place output section at address (.name=addr)", [&](std::string spec) {
+        size_t eq = spec.find('=');
+        if (eq == std::string::npos || eq == 0) {
+            throw std::runtime_error("--section-start expects .name=addr, got " + spec);
+        }
+        options.section_start[spec.substr(0, eq)] = std::stoull(spec.substr(eq + 1), nullptr, 0);
+    });
+
+    parser.add_option_cb("--call-graph-profile", "Order .text by weighted caller/callee edges from a file", [&](std::string path) {
+        std::ifstream profile_file(path);
+        if (!profile_file) {
+            throw std::runtime_error("cannot open call graph profile " + path);
+        }
+        options.call_graph_profile.assign(std::istreambuf_iterator<char>(profile_file), std::istreambuf_iterator<char>());
+    });
+
+    parser.add_option_cb("--threads", "Number of threads for parallel phases", [&](std::string n) {
+        cmd.threads = std::stoul(n);
+        cmd.threads_given = true;
+    });
+    parser.add_flag(cmd.verify_determinism, "--verify-determinism", "Link with 1 and N threads and compare outputs");
+    parser.add_flag(cmd.check_only, "--check-only", "Only report undefined and duplicate symbols, write no output");
+    parser.add_option(cmd.batch_manifest, "--batch", "Run every link listed in a JSON manifest");
+    parser.add_option(cmd.server_socket, "--server", "Serve links on a Unix socket, caching parsed inputs");
+    parser.add_option_cb("--server-cache-entries", "With --server: keep at most N parsed inputs (default 256)", [&](std::string n) {
+        cmd.server_cache_entries = std::stoul(n);
+        if (cmd.server_cache_entries == 0) {
+            throw std::runtime_error("--server-cache-entries must be at least 1");
+        }
+    });
+    parser.add_option(cmd.connect_socket, "--connect", "Forward this link to the server on a Unix socket");
+    parser.add_flag(cmd.stop_server, "--stop-server", "With --connect: ask the server to exit");
+    parser.add_option(cmd.link_cache, "--link-cache", "Reuse outputs of identical links from a cache directory");
+    parser.add_flag_cb("--as-needed", "Only record shared libraries that resolve a reference", [&]() {
+        as_needed = true;
+    });
+    parser.add_flag_cb("--no-as-needed", "Record every following shared library (default)", [&]() {
+        as_needed = false;
+    });
+
+    parser.add_option_cb("-l", "Link library", [&](std::string lib_name) {
+        ordered_inputs.push_back({ InputItem::Library, lib_name, as_needed });
+    });
+
+    parser.on_positional([&](std::string file_path) {
+        ordered_inputs.push_back({ InputItem::File, file_path, as_needed });
+    });
+
+    parser.parse(args);
+
+    if (ordered_inputs.empty() && cmd.batch_manifest.empty() && cmd.server_socket.empty() && !cmd.stop_server) {
+        throw std::runtime_error("No inputs");
+    }
+
+    lib_paths.push_back("./");
+
+    for (const auto& item : ordered_inputs) {
+        if (item.type == InputItem::File) {
+            cmd.input_paths.push_back(item.value);
+        } else if (item.type == InputItem::Library) {
+            cmd.input_paths.push_back(find_library(item.value, lib_paths, options.is_static));
+        }
+        options.as_needed.push_back(item.as_needed);
+    }
+    return cmd;
+}
+
+/**
+ * 64 位流式内容哈希，算法同 XXH64：四路乘-旋转累加，按 32 字节一组处理
+ *
+ * 数据可以分块喂入，文件不需要整个读进内存。
+ */
+class ContentHasher {
+public:
+    explicit ContentHasher(uint64_t seed = 0)
+        : acc { seed + P1 + P2, seed + P2, seed, seed - P1 }
+        , seed(seed)
+    {
+    }
+
+    void update(const void* data, size_t size)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        total += size;
+        if (buffered != 0) {
+            size_t take = std::min(size, sizeof(buffer) - buffered);
+            memcpy(buffer + buffered, p, take);
+            buffered += take;
+            p += take;
+            size -= take;
+            if (buffered < sizeof(buffer)) {
+                return;
+            }
+            consume_stripe(buffer);
+            buffered = 0;
+        }
+        for (; size >= sizeof(buffer); p += sizeof(buffer), size -= sizeof(buffer)) {
+            consume_stripe(p);
+        }
+        memcpy(buffer, p, size);
+        buffered = size;
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t h;
+        if (total >= sizeof(buffer)) {
+            h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+            for (uint64_t lane : acc) {
+                h = (h ^ round(0, lane)) * P1 + P4;
+            }
+        } else {
+            h = seed + P5;
+        }
+        h += total;
+
+        size_t i = 0;
+        for (; i + 8 <= buffered; i += 8) {
+            h = rotl(h ^ round(0, read64(buffer + i)), 27) * P1 + P4;
+        }
+        if (i + 4 <= buffered) {
+            uint32_t word;
+            memcpy(&word, buffer + i, 4);
+            h = rotl(h ^ (word * P1), 23) * P2 + P3;
+            i += 4;
+        }
+        for (; i < buffered; i++) {
+            h = rotl(h ^ (buffer[i] * P5), 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+    uint64_t acc[4];
+    uint64_t seed;
+    uint64_t total = 0;
+    uint8_t buffer[32];
+    size_t buffered = 0;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static uint64_t read64(const uint8_t* p)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+
+    static uint64_t round(uint64_t lane, uint64_t input) { return rotl(lane + input * P2, 31) * P1; }
+
+    void consume_stripe(const uint8_t* p)
+    {
+        for (int lane = 0; lane < 4; lane++) {
+            acc[lane] = round(acc[lane], read64(p + lane * 8));
+        }
+    }
 };
 
+// 分块读取并哈希一个文件
+static uint64_t hash_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    ContentHasher hasher;
+    std::vector<char> chunk(1 << 16);
+    while (in.read(chunk.data(), chunk.size()) || in.gcount() > 0) {
+        hasher.update(chunk.data(), in.gcount());
+    }
+    return hasher.digest();
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * 整次链接的结果缓存（--link-cache=<dir>）
+ *
+ * 键由所有输入文件（-l 已解析为路径）的内容哈希与文件名、影响输出的
+ * 链接选项和 ld 自身的版本（可执行文件的大小与修改时间）组成。共享库的
+ * 文件名会作为 needed 写入输出，所以内容相同、名字不同的输入不能共用结果；
+ * 输出文件名不写入结果，因此不参与。命中时直接复制缓存的输出，
+ * 既不解析输入也不调用 FLE_ld。目录内容：
+ *   <key>.fle   链接输出
+ *   <key>.time  当初链接耗费的毫秒数，命中时据此计算节省的时间
+ *   stats       累计的命中数、未命中数和节省的毫秒数，加 flock 更新
+ */
+class LinkCache {
+public:
+    explicit LinkCache(const LdCommand& cmd)
+        : dir(cmd.link_cache)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // 输入文件在线程池上并行哈希
+        std::vector<uint64_t> input_hashes(cmd.input_paths.size());
+        parallel_for(cmd.input_paths.size(), [&](size_t i) {
+            input_hashes[i] = hash_file(cmd.input_paths[i]);
+        });
+
+        const LinkerOptions& options = cmd.options;
+        json key_json;
+        std::vector<std::string> input_names;
+        for (const auto& path : cmd.input_paths) {
+            input_names.push_back(get_basename(path));
+        }
+        key_json["format"] = 2;
+        key_json["inputs"] = input_hashes;
+        key_json["input_names"] = input_names;
+        key_json["shared"] = options.shared;
+        key_json["entry"] = options.entryPoint;
+        key_json["static"] = options.is_static;
+        key_json["as_needed"] = options.as_needed;
+        key_json["script"] = options.script;
+        key_json["section_start"] = options.section_start;
+        key_json["call_graph_profile"] = options.call_graph_profile;
+        struct stat st;
+        if (stat("/proc/self/exe", &st) == 0) {
+            key_json["tool"] = { int64_t(st.st_size), int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec };
+        }
+        std::string key_text = key_json.dump();
+        ContentHasher hasher;
+        hasher.update(key_text.data(), key_text.size());
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hasher.digest()));
+        key = hex;
+
+        hash_ms = elapsed_ms(start);
+    }
+
+    // 命中时把缓存的输出放到 output 并返回 true
+    bool fetch(const std::string& output)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fs::path entry = dir / (key + ".fle");
+        std::error_code ec;
+        if (!fs::is_regular_file(entry, ec)) {
+            return false;
+        }
+        double link_ms = 0;
+        std::ifstream(dir / (key + ".time")) >> link_ms;
+        fs::copy_file(entry, output, fs::copy_options::overwrite_existing, ec);
+        if (ec) {
+            return false;
+        }
+
+        double saved_ms = std::max(0.0, link_ms - hash_ms - elapsed_ms(start));
+        Totals totals = update_totals(1, 0, saved_ms);
+        std::cerr << "ld: link cache hit " << key << ", saved " << format_ms(saved_ms) << " ms ("
+                  << totals.hits << " hits, " << totals.misses << " misses, " << format_ms(totals.saved_ms)
+                  << " ms saved in total)" << std::endl;
+        return true;
+    }
+
+    // 未命中：链接完成后保存输出，link_ms 为本次链接的耗时
+    // 缓存是可选的，保存失败（目录只读、磁盘已满等）只给出警告，不影响链接结果
+    void store(const std::string& output, double link_ms)
+    {
+        // 先写临时文件再改名，并发的链接不会读到写了一半的条目
+        std::string tmp_suffix = ".tmp" + std::to_string(getpid());
+        fs::path entry = dir / (key + ".fle");
+        fs::path time_file = dir / (key + ".time");
+        fs::path entry_tmp = entry.string() + tmp_suffix;
+        fs::path time_tmp = time_file.string() + tmp_suffix;
+        try {
+            fs::create_directories(dir);
+            fs::copy_file(output, entry_tmp, fs::copy_options::overwrite_existing);
+            std::ofstream time_out(time_tmp);
+            time_out << link_ms << std::endl;
+            if (!time_out) {
+                throw fs::filesystem_error("cannot write", time_tmp, std::make_error_code(std::errc::io_error));
+            }
+            time_out.close();
+            fs::rename(time_tmp, time_file);
+            fs::rename(entry_tmp, entry);
+        } catch (const fs::filesystem_error& e) {
+            std::error_code ec;
+            fs::remove(entry_tmp, ec);
+            fs::remove(time_tmp, ec);
+            std::cerr << "ld: link cache: cannot store " << key << ": " << e.what() << std::endl;
+            return;
+        }
+
+        Totals totals = update_totals(0, 1, 0);
+        std::cerr << "ld: link cache miss " << key << ", linked in " << format_ms(link_ms) << " ms ("
+                  << totals.hits << " hits, " << totals.misses << " misses, " << format_ms(totals.saved_ms)
+                  << " ms saved in total)" << std::endl;
+    }
+
+private:
+    struct Totals {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        double saved_ms = 0;
+    };
+
+    fs::path dir;
+    std::string key;
+    double hash_ms = 0;
+
+    static std::string format_ms(double ms)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.1f", ms);
+        return buf;
+    }
+
+    Totals update_totals(uint64_t hits, uint64_t misses, double saved_ms)
+    {
+        Totals totals;
+        std::string path = (dir / "stats").string();
+        FILE* file = fopen(path.c_str(), "a+");
+        if (file == nullptr) {
+            return totals;
+        }
+        flock(fileno(file), LOCK_EX);
+        rewind(file);
+        unsigned long long h = 0, m = 0;
+        if (fscanf(file, "%llu %llu %lf", &h, &m, &totals.saved_ms) == 3) {
+            totals.hits = h;
+            totals.misses = m;
+        } else {
+            totals.saved_ms = 0;
+        }
+        totals.hits += hits;
+        totals.misses += misses;
+        totals.saved_ms += saved_ms;
+        if (ftruncate(fileno(file), 0) == 0) {
+            fprintf(file, "%llu %llu %.3f\n", static_cast<unsigned long long>(totals.hits),
+                static_cast<unsigned long long>(totals.misses), totals.saved_ms);
+        }
+        fclose(file);
+        return totals;
+    }
+};
+
+// 按路径提供输入对象；metadata_only 表示调用方不需要节内容
+using InputLoader = std::function<std::shared_ptr<const FLEObject>(const std::string& path, bool metadata_only)>;
+
+/**
+ * 执行一次链接（或 --check-only 检查）并写出结果
+ * @return 进程退出码
+ */
+static int run_ld(const LdCommand& cmd, const InputLoader& load)
+{
+    const LinkerOptions& options = cmd.options;
+    auto start = std::chrono::steady_clock::now();
+
+    // --check-only 和 --verify-determinism 需要真正执行链接，不使用缓存
+    std::unique_ptr<LinkCache> cache;
+    if (!cmd.link_cache.empty() && !cmd.check_only && !cmd.verify_determinism) {
+        cache = std::make_unique<LinkCache>(cmd);
+        if (cache->fetch(options.outputFile)) {
+            return 0;
+        }
+    }
+
+    std::vector<std::shared_ptr<const FLEObject>> inputs;
+    std::vector<const FLEObject*> objects;
+    for (const auto& path : cmd.input_paths) {
+        inputs.push_back(load(path, cmd.check_only));
+        objects.push_back(inputs.back().get());
+    }
+
+    if (cmd.check_only) {
+        std::vector<std::string> errors = FLE_ld_check(objects, options);
+        for (const auto& error : errors) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+        return errors.empty() ? 0 : 1;
+    }
+
+    FLEObject result = FLE_ld(objects, options);
+
+    if (cmd.verify_determinism) {
+        // 线程池只在这里临时换成单线程；服务器处理请求时池中没有其他任务
+        size_t parallel_threads = global_thread_pool().size();
+        set_thread_count(1);
+        FLEObject serial = FLE_ld(objects, options);
+        set_thread_count(parallel_threads);
+        std::string diff = first_link_difference(serial, result);
+        if (!diff.empty()) {
+            throw std::runtime_error("non-deterministic link: " + diff + " (1 thread vs "
+                + std::to_string(parallel_threads) + " threads)");
+        }
+        std::cerr << "ld: output is identical with 1 and " << parallel_threads << " threads" << std::endl;
+    }
+
+    FLEWriter writer;
+    FLE_objdump(result, writer);
+    writer.write_to_file(options.outputFile);
+    if (cache) {
+        cache->store(options.outputFile, elapsed_ms(start));
+    }
+    return 0;
+}
+
+/**
+ * 批量链接：清单中的每一项是一次独立的链接
+ *
+ * 清单格式为 [{"output": "...", "inputs": [...], "options": [...]}, ...]，
+ * options 与 inputs 依次拼成该项的 ld 命令行（inputs 中也可以写 -l）。
+ * 所有项用到的输入文件只解析一次并以只读方式共享，各项在线程池上并发链接，
+ * 每一项单独报告结果，一项失败不影响其他项。
+ * @return 全部成功时返回 0，否则返回 1
+ */
+static int run_ld_batch(const std::string& manifest_path, size_t threads)
+{
+    std::ifstream manifest_file(manifest_path);
+    if (!manifest_file) {
+        throw std::runtime_error("cannot open batch manifest " + manifest_path);
+    }
+    json manifest = json::parse(manifest_file);
+    if (!manifest.is_array()) {
+        throw std::runtime_error("batch manifest must be a JSON array of links");
+    }
+
+    struct BatchEntry {
+        std::string output;
+        LdCommand cmd;
+        std::vector<std::string> errors;
+    };
+    std::vector<BatchEntry> entries(manifest.size());
+
+    // 解析每一项的命令行并收集用到的输入文件
+    std::map<std::string, size_t> input_index;
+    std::vector<std::string> unique_inputs;
+    for (size_t i = 0; i < manifest.size(); i++) {
+        const json& item = manifest[i];
+        BatchEntry& entry = entries[i];
+        try {
+            if (!item.is_object() || !item.contains("output")) {
+                throw std::runtime_error("entry has no output");
+            }
+            entry.output = item["output"].get<std::string>();
+
+            std::vector<std::string> entry_args;
+            for (const char* key : { "options", "inputs" }) {
+                if (item.contains(key)) {
+                    for (const auto& arg : item[key]) {
+                        entry_args.push_back(arg.get<std::string>());
+                    }
+                }
+            }
+            entry_args.push_back("-o");
+            entry_args.push_back(entry.output);
+
+            entry.cmd = parse_ld_command(entry_args);
+            if (entry.cmd.verify_determinism || !entry.cmd.batch_manifest.empty()
+                || !entry.cmd.server_socket.empty() || !entry.cmd.connect_socket.empty()) {
+                throw std::runtime_error("--verify-determinism, --batch, --server and --connect cannot be used inside a batch");
+            }
+            // 各项共享一次输入加载，不经过 run_ld，缓存无从生效
+            if (!entry.cmd.link_cache.empty()) {
+                throw std::runtime_error("--link-cache cannot be used inside a batch");
+            }
+            for (const auto& path : entry.cmd.input_paths) {
+                if (input_index.emplace(path, unique_inputs.size()).second) {
+                    unique_inputs.push_back(path);
+                }
+            }
+        } catch (const ArgParser::HelpRequested&) {
+            entry.errors.push_back("-h is not valid inside a batch");
+        } catch (const std::exception& e) {
+            entry.errors.push_back(e.what());
+        }
+    }
+
+    set_thread_count(threads);
+    size_t pool_size = global_thread_pool().size();
+    // 各项共用批量模式的线程池，单项的 --threads 无法生效
+    for (const auto& entry : entries) {
+        if (entry.errors.empty() && entry.cmd.threads_given) {
+            std::cerr << "ld: " << entry.output << ": --threads is ignored inside a batch, all links share "
+                      << pool_size << " threads" << std::endl;
+        }
+    }
+
+    // 每个输入文件只解析一次
+    std::vector<FLEObject> inputs(unique_inputs.size());
+    std::vector<std::string> load_errors(unique_inputs.size());
+    parallel_for(unique_inputs.size(), [&](size_t i) {
+        try {
+            inputs[i] = load_fle(unique_inputs[i]);
+        } catch (const std::exception& e) {
+            load_errors[i] = unique_inputs[i] + ": " + e.what();
+        }
+    });
+
+    parallel_for(entries.size(), [&](size_t i) {
+        BatchEntry& entry = entries[i];
+        if (!entry.errors.empty()) {
+            return;
+        }
+        try {
+            std::vector<const FLEObject*> objects;
+            for (const auto& path : entry.cmd.input_paths) {
+                size_t idx = input_index.at(path);
+                if (!load_errors[idx].empty()) {
+                    throw std::runtime_error(load_errors[idx]);
+                }
+                objects.push_back(&inputs[idx]);
+            }
+
+            const LinkerOptions& options = entry.cmd.options;
+            if (entry.cmd.check_only) {
+                entry.errors = FLE_ld_check(objects, options);
+                return;
+            }
+
+            FLEObject result = FLE_ld(objects, options);
+            FLEWriter writer;
+            FLE_objdump(result, writer);
+            writer.write_to_file(entry.output);
+        } catch (const std::exception& e) {
+            entry.errors.push_back(e.what());
+        }
+    });
+
+    size_t failed = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const BatchEntry& entry = entries[i];
+        std::string label = entry.output.empty() ? "entry #" + std::to_string(i) : entry.output;
+        if (entry.errors.empty()) {
+            std::cout << label << ": ok" << std::endl;
+        } else {
+            failed++;
+            for (const auto& error : entry.errors) {
+                std::cerr << "Error: " << label << ": " << error << std::endl;
+            }
+        }
+    }
+    std::cout << "ld: batch: " << entries.size() - failed << " of " << entries.size() << " links succeeded" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+static std::string read_all(int fd)
+{
+    std::string data;
+    char buf[65536];
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error("ld server: read failed: "s + strerror(errno));
+        }
+        if (n == 0) {
+            return data;
+        }
+        data.append(buf, n);
+    }
+}
+
+static void write_all(int fd, const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size()) {
+        // 对端提前断开时返回 EPIPE 而不是收到 SIGPIPE
+        ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error("ld server: write failed: "s + strerror(errno));
+        }
+        done += n;
+    }
+}
+
+static sockaddr_un unix_socket_address(const std::string& socket_path)
+{
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("invalid socket path " + socket_path);
+    }
+    std::strcpy(addr.sun_path, socket_path.c_str());
+    return addr;
+}
+
+/**
+ * 常驻链接服务器
+ *
+ * 每个连接是一次请求：客户端发送 {"cwd": ..., "args": [...]} 后关闭写端，
+ * 服务器在 cwd 下按 args 执行链接，返回 {"status", "stdout", "stderr"}。
+ * 解析过的输入对象按绝对路径缓存，文件的修改时间或大小变化时重新解析，
+ * 因此编辑-链接循环中未改动的输入（如 minilibc.fo 和静态库）不再重复解析。
+ * 请求按顺序处理，链接内部的并行阶段仍使用线程池。
+ */
+static int run_ld_server(const std::string& socket_path, size_t threads, size_t max_cached)
+{
+    sockaddr_un addr = unix_socket_address(socket_path);
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error("ld server: socket failed: "s + strerror(errno));
+    }
+    // 清理上次异常退出留下的套接字文件；其他类型的文件绝不删除
+    struct stat st;
+    if (lstat(socket_path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            close(listen_fd);
+            throw std::runtime_error("ld server: " + socket_path + " exists and is not a socket");
+        }
+        unlink(socket_path.c_str());
+    }
+    // 服务器以自己的身份在请求的目录下写文件，套接字只允许属主连接
+    mode_t saved_umask = umask(0177);
+    int bound = bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    umask(saved_umask);
+    if (bound != 0 || listen(listen_fd, 16) != 0) {
+        std::string error = strerror(errno);
+        close(listen_fd);
+        throw std::runtime_error("ld server: cannot listen on " + socket_path + ": " + error);
+    }
+
+    set_thread_count(threads);
+    // 请求在客户端的目录下执行，处理完后回到这里
+    std::string server_cwd = fs::current_path().string();
+
+    // 按路径缓存解析后的输入；文件改写后重新加载时替换原条目，
+    // 条目数超过 max_cached 时淘汰最久未使用的
+    struct CachedObject {
+        int64_t mtime_ns;
+        off_t size;
+        std::shared_ptr<const FLEObject> obj;
+        std::list<std::string>::iterator lru_pos;
+    };
+    std::map<std::string, CachedObject> cache;
+    std::list<std::string> lru; // 最近使用的路径在前
+
+    std::cerr << "ld: server listening on " << socket_path << std::endl;
+
+    bool running = true;
+    while (running) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::string error = strerror(errno);
+            close(listen_fd);
+            throw std::runtime_error("ld server: accept failed: " + error);
+        }
+
+        std::ostringstream out;
+        std::ostringstream err;
+        int status = 1;
+        std::string output = "-";
+        size_t cached = 0;
+        size_t loaded = 0;
+
+        try {
+            json request = json::parse(read_all(fd));
+            std::string cwd = request.at("cwd").get<std::string>();
+            std::vector<std::string> args = request.at("args").get<std::vector<std::string>>();
+            if (chdir(cwd.c_str()) != 0) {
+                throw std::runtime_error("cannot change to directory " + cwd);
+            }
+
+            // 请求执行期间的输出转交给客户端
+            std::streambuf* saved_out = std::cout.rdbuf(out.rdbuf());
+            std::streambuf* saved_err = std::cerr.rdbuf(err.rdbuf());
+            try {
+                LdCommand cmd = parse_ld_command(args);
+                output = cmd.options.outputFile;
+                if (cmd.stop_server) {
+                    output = "--stop-server";
+                    running = false;
+                    status = 0;
+                } else if (!cmd.server_socket.empty() || !cmd.batch_manifest.empty()) {
+                    throw std::runtime_error("--server and --batch cannot be forwarded to a server");
+                } else {
+                    if (cmd.threads_given) {
+                        std::cerr << "ld: --threads is ignored by the server, it links on "
+                                  << global_thread_pool().size() << " threads" << std::endl;
+                    }
+                    status = run_ld(cmd, [&](const std::string& path, bool) {
+                        std::string key = fs::absolute(path).lexically_normal().string();
+                        struct stat st;
+                        if (stat(key.c_str(), &st) != 0) {
+                            throw std::runtime_error("cannot open " + path);
+                        }
+                        int64_t mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+                        auto it = cache.find(key);
+                        if (it != cache.end()) {
+                            lru.splice(lru.begin(), lru, it->second.lru_pos);
+                            if (it->second.mtime_ns == mtime_ns && it->second.size == st.st_size) {
+                                cached++;
+                                return it->second.obj;
+                            }
+                        }
+                        // 缓存完整对象，--check-only 的请求也可以复用
+                        auto obj = std::make_shared<const FLEObject>(load_fle(path));
+                        if (it != cache.end()) {
+                            it->second = { mtime_ns, st.st_size, obj, lru.begin() };
+                        } else {
+                            lru.push_front(key);
+                            cache.emplace(key, CachedObject { mtime_ns, st.st_size, obj, lru.begin() });
+                            if (cache.size() > max_cached) {
+                                cache.erase(lru.back());
+                                lru.pop_back();
+                            }
+                        }
+                        loaded++;
+                        return obj;
+                    });
+                }
+            } catch (const ArgParser::HelpRequested&) {
+                status = 0;
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                status = 1;
+            }
+            std::cout.rdbuf(saved_out);
+            std::cerr.rdbuf(saved_err);
+        } catch (const std::exception& e) {
+            err << "Error: " << e.what() << std::endl;
+        }
+
+        if (chdir(server_cwd.c_str()) != 0) {
+            err << "Error: cannot return to " << server_cwd << std::endl;
+            running = false;
+        }
+
+        json response;
+        response["status"] = status;
+        response["stdout"] = out.str();
+        response["stderr"] = err.str();
+        try {
+            write_all(fd, response.dump());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+        close(fd);
+
+        std::cerr << "ld: server: " << output << ": status " << status << ", "
+                  << cached << " cached, " << loaded << " loaded" << std::endl;
+    }
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    return 0;
+}
+
+/**
+ * 客户端模式：把命令行和当前目录转发给服务器，原样输出服务器返回的结果
+ * @return 服务器上链接的退出码
+ */
+static int run_ld_client(const std::string& socket_path, const std::vector<std::string>& args)
+{
+    sockaddr_un addr = unix_socket_address(socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::string error = strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("cannot connect to ld server at " + socket_path + ": " + error);
+    }
+
+    json request;
+    request["cwd"] = fs::current_path().string();
+    request["args"] = args;
+    json response;
+    try {
+        write_all(fd, request.dump());
+        shutdown(fd, SHUT_WR);
+        response = json::parse(read_all(fd));
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    std::cout << response.at("stdout").get<std::string>();
+    std::cerr << response.at("stderr").get<std::string>();
+    return response.at("status").get<int>();
+}
+
 int main(int argc, char* argv[])
 {
     // singlestack
@@ -459,11 +1488,12 @@ int main(int argc, char* argv[])
         std::cerr << "Usage: " << argv[0] << " <command> [args...]\n"
                   << "Commands:\n"
                   << "  objdump <input>                  Display contents of FLE file\n"
-                  << "  nm <input>                       Display symbol table\n"
+                  << "  nm <input> [address...]          Display symbol table or symbolize addresses\n"
                   << "  ld [-o output] input1 input2...  Link FLE files (.fo/.fa/.fle)\n"
-                  << "  exec <input.fle>                 Execute FLE file\n"
+                  << "  exec [options] <input.fle>       Execute FLE file\n"
                   << "  cc [-o output.o] input.c...      Compile C files (outputs .fo)\n"
                   << "  ar <output.fa> <input.fo>...     Create static archive\n"
+                  << "  bundle <output> <program>        Pack a program and its libraries into one file\n"
                   << "  readfle <input>                  Display FLE file information\n"
                   << "  disasm <input> <section>         Disassemble section\n";
         return 1;
@@ -481,67 +1511,70 @@ int main(int argc, char* argv[])
             FLE_objdump(load_fle(args[0]), writer);
             writer.write_to_file(args[0] + ".objdump");
         } else if (tool == "FLE_nm") {
-            if (args.size() != 1) {
-                throw std::runtime_error("Usage: nm <input>");
+            if (args.empty()) {
+                throw std::runtime_error("Usage: nm <input> [address...]");
             }
-            FLE_nm(load_fle(args[0]));
-        } else if (tool == "FLE_exec") {
-            if (args.size() != 1) {
-                throw std::runtime_error("Usage: exec <input.fle>");
+            if (args.size() == 1) {
+                FLE_nm(load_fle(args[0]));
+            } else {
+                std::vector<uint64_t> addrs;
+                for (size_t i = 1; i < args.size(); i++) {
+                    addrs.push_back(std::stoull(args[i], nullptr, 16));
+                }
+                FLE_nm_lookup(load_fle(args[0]), addrs);
             }
-            FLE_exec(load_fle(args[0]));
-        } else if (tool == "FLE_ld") {
-            LinkerOptions options;
-            std::vector<InputItem> ordered_inputs;
-            std::vector<std::string> lib_paths;
-
-            ArgParser parser("ld");
-
-            parser.add_option(options.outputFile, "-o, --output", "Output file");
-            parser.add_option(options.entryPoint, "-e, --entry", "Entry point");
-            parser.add_flag(options.shared, "-shared", "Create shared library");
-            parser.add_flag(options.is_static, "-static", "Static linking");
-            parser.add_multi_option(lib_paths, "-L", "Add library search path");
-
-            parser.add_option_cb("-l", "Link library", [&](std::string lib_name) {
-                ordered_inputs.push_back({ InputItem::Library, lib_name });
+        } else if (tool == "FLE_exec") {
+            ExecOptions options;
+            ArgParser parser("exec");
+            parser.add_flag(options.count_imports, "--count-imports", "Count calls to shared-library functions and report them at exit");
+            parser.add_flag(options.fork_server, "--fork-server", "Load once, then run the program once per request on fd 198, reporting on fd 199");
+            parser.add_flag(options.stats, "--stats", "Report time, memory, faults and hardware counters when the program exits");
+            parser.add_option_cb("--runs", "With --stats: run N times and report median, min and max", [&](std::string n) {
+                options.runs = std::stoul(n);
             });
-
-            parser.on_positional([&](std::string file_path) {
-                ordered_inputs.push_back({ InputItem::File, file_path });
+            parser.add_option_cb("--pin-cpu", "With --stats: run on the given CPU only", [&](std::string cpu) {
+                options.pin_cpu = std::stoi(cpu);
             });
-
             try {
                 parser.parse(args);
             } catch (const ArgParser::HelpRequested&) {
                 return 0;
-            } catch (const std::exception& e) {
-                std::cerr << "Error: " << e.what() << "\n";
-                return 1;
             }
-
-            if (ordered_inputs.empty()) {
-                std::cerr << "Error: No inputs\n";
-                return 1;
+            if (parser.positional().size() != 1) {
+                throw std::runtime_error("Usage: exec [--count-imports] [--fork-server] [--stats [--runs N] [--pin-cpu CPU]] <input.fle>");
             }
-
-            std::vector<FLEObject> objects;
-            lib_paths.push_back("./");
-
-            for (const auto& item : ordered_inputs) {
-                if (item.type == InputItem::File) {
-                    objects.push_back(load_fle(item.value));
-                } else if (item.type == InputItem::Library) {
-                    std::string path = find_library(item.value, lib_paths, options.is_static);
-                    objects.push_back(load_fle(path));
-                }
+            if (!options.stats && (options.runs != 1 || options.pin_cpu >= 0)) {
+                throw std::runtime_error("--runs and --pin-cpu require --stats");
+            }
+            if (options.runs == 0) {
+                throw std::runtime_error("--runs must be at least 1");
+            }
+            FLE_exec(load_fle(parser.positional()[0]), options);
+        } else if (tool == "FLE_ld") {
+            LdCommand cmd;
+            try {
+                cmd = parse_ld_command(args);
+            } catch (const ArgParser::HelpRequested&) {
+                return 0;
             }
 
-            FLEObject result = FLE_ld(objects, options);
+            if (!cmd.server_socket.empty()) {
+                return run_ld_server(cmd.server_socket, cmd.threads, cmd.server_cache_entries);
+            }
+            if (!cmd.connect_socket.empty()) {
+                return run_ld_client(cmd.connect_socket, args);
+            }
+            if (cmd.stop_server) {
+                throw std::runtime_error("--stop-server requires --connect");
+            }
+            if (!cmd.batch_manifest.empty()) {
+                return run_ld_batch(cmd.batch_manifest, cmd.threads);
+            }
 
-            FLEWriter writer;
-            FLE_objdump(result, writer);
-            writer.write_to_file(options.outputFile);
+            set_thread_count(cmd.threads);
+            return run_ld(cmd, [](const std::string& path, bool metadata_only) {
+                return std::make_shared<const FLEObject>(load_fle(path, metadata_only));
+            });
         } else if (tool == "FLE_cc") {
             FLE_cc(args);
         } else if (tool == "FLE_readfle") {
@@ -556,6 +1589,11 @@ int main(int argc, char* argv[])
             FLE_disasm(load_fle(args[0]), args[1]);
         } else if (tool == "FLE_ar") {
             FLE_ar(args);
+        } else if (tool == "FLE_bundle") {
+            if (args.size() != 2) {
+                throw std::runtime_error("Usage: bundle <output> <program>");
+            }
+            FLE_bundle(args[0], args[1]);
         } else {
             std::cerr << "Unknown tool: " << tool << std::endl;
             return 1;
@@ -1,10 +1,182 @@
 #include "fle.hpp"
+#include "parallel.hpp"
 #include <algorithm>
 #include <cstdlib>
-#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 
+namespace {
+
+struct RelocForOutput {
+    Relocation reloc;
+    bool dynamic;
+};
+
+std::string format_reloc(const RelocForOutput& entry)
+{
+    auto type_to_tag = [&](RelocationType type, bool dynamic) -> std::string {
+        switch (type) {
+        case RelocationType::R_X86_64_PC32:
+            return dynamic ? ".dynrel" : ".rel";
+        case RelocationType::R_X86_64_64:
+            return dynamic ? ".dynabs64" : ".abs64";
+        case RelocationType::R_X86_64_32:
+            return dynamic ? ".dynabs32" : ".abs";
+        case RelocationType::R_X86_64_32S:
+            return dynamic ? ".dynabs32" : ".abs32s";
+        case RelocationType::R_X86_64_GOTPCREL:
+            if (!dynamic)
+                return ".gotpcrel";
+            break;
+        case RelocationType::R_X86_64_TPOFF32:
+            if (!dynamic)
+                return ".tpoff32";
+            break;
+        case RelocationType::R_X86_64_GOTTPOFF:
+            if (!dynamic)
+                return ".gottpoff";
+            break;
+        case RelocationType::R_X86_64_COPY:
+            if (dynamic)
+                return ".dyncopy";
+            break;
+        }
+        throw std::runtime_error("Unsupported relocation type in objdump");
+    };
+
+    const auto tag = type_to_tag(entry.reloc.type, entry.dynamic);
+    const char sign = entry.reloc.addend < 0 ? '-' : '+';
+    auto abs_addend = static_cast<uint64_t>(std::llabs(entry.reloc.addend));
+
+    std::ostringstream ss;
+    ss << "❓: " << tag << "(" << entry.reloc.symbol << " " << sign << " " << abs_addend << ")";
+    return ss.str();
+}
+
+std::string format_symbol(const Symbol& sym)
+{
+    std::string line;
+    switch (sym.type) {
+    case SymbolType::LOCAL:
+        line = "🏷️: " + sym.name;
+        break;
+    case SymbolType::WEAK:
+        line = "📎: " + sym.name;
+        break;
+    case SymbolType::GLOBAL:
+        line = "📤: " + sym.name;
+        break;
+    default:
+        [[unlikely]] throw std::runtime_error("unknown symbol type");
+    }
+    return line + " " + std::to_string(sym.size) + " " + std::to_string(sym.offset);
+}
+
+// "🔢: " 后跟最多 16 个以空格分隔的十六进制字节
+std::string format_bytes(const uint8_t* data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string line = "🔢: ";
+    line.reserve(line.size() + size * 3);
+    for (size_t i = 0; i < size; ++i) {
+        if (i != 0) {
+            line += ' ';
+        }
+        line += digits[data[i] >> 4];
+        line += digits[data[i] & 0xf];
+    }
+    return line;
+}
+
+// 节内偏移 -> 该处定义的符号
+using SectionSymbols = std::map<size_t, std::vector<const Symbol*>>;
+
+/**
+ * 把一个节序列化为 FLE 行：符号、重定位和数据，数据在符号和重定位处断行
+ * 各节互不依赖，可以并发调用
+ */
+json serialize_section(const FLESection& section, const SectionSymbols* symbols,
+    const std::vector<Relocation>* dyn_relocs)
+{
+    json lines = json::array();
+
+    std::map<size_t, std::vector<RelocForOutput>> reloc_index;
+    for (const auto& reloc : section.relocs) {
+        reloc_index[reloc.offset].push_back({ reloc, false });
+    }
+    if (dyn_relocs != nullptr) {
+        for (const auto& reloc : *dyn_relocs) {
+            reloc_index[reloc.offset].push_back({ reloc, true });
+        }
+    }
+
+    // NOBITS 节没有内容，只输出符号；大小由节头或程序头给出
+    if (section.nobits) {
+        if (symbols != nullptr) {
+            for (const auto& [offset, syms] : *symbols) {
+                for (const Symbol* sym : syms) {
+                    lines.push_back(format_symbol(*sym));
+                }
+            }
+        }
+        return lines;
+    }
+
+    std::vector<size_t> breaks;
+    if (symbols != nullptr) {
+        for (const auto& [offset, _] : *symbols) {
+            breaks.push_back(offset);
+        }
+    }
+    for (const auto& [offset, _] : reloc_index) {
+        breaks.push_back(offset);
+    }
+    std::sort(breaks.begin(), breaks.end());
+    breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+
+    size_t pos = 0;
+    while (pos < section.data.size()) {
+        if (symbols != nullptr) {
+            auto offset_it = symbols->find(pos);
+            if (offset_it != symbols->end()) {
+                for (const Symbol* sym : offset_it->second) {
+                    lines.push_back(format_symbol(*sym));
+                }
+            }
+        }
+
+        auto reloc_it = reloc_index.find(pos);
+        if (reloc_it != reloc_index.end()) {
+            size_t reloc_size = 0;
+            for (const auto& reloc_entry : reloc_it->second) {
+                lines.push_back(format_reloc(reloc_entry));
+                reloc_size += relocation_size(reloc_entry.reloc.type);
+            }
+            // 复制重定位不占字节，其后照常输出符号的数据
+            if (reloc_size != 0) {
+                pos += reloc_size;
+                continue;
+            }
+        }
+
+        size_t next_break = section.data.size();
+        auto upper = std::upper_bound(breaks.begin(), breaks.end(), pos);
+        if (upper != breaks.end()) {
+            next_break = *upper;
+        }
+
+        while (pos < next_break) {
+            size_t chunk_size = std::min({ size_t(16), next_break - pos, section.data.size() - pos });
+            lines.push_back(format_bytes(section.data.data() + pos, chunk_size));
+            pos += chunk_size;
+        }
+    }
+    return lines;
+}
+
+} // namespace
+
 void FLE_objdump(const FLEObject& obj, FLEWriter& writer)
 {
     writer.set_type(obj.type);
@@ -32,14 +204,26 @@ void FLE_objdump(const FLEObject& obj, FLEWriter& writer)
         }
     }
 
-    // 预处理：构建符号表索引
-    std::map<std::string, std::map<size_t, std::vector<Symbol>>> symbol_index;
+    // 链接产物的按地址排序的符号索引
+    if (!obj.symbol_index.entries.empty()) {
+        writer.write_symbol_index(obj.symbol_index);
+    }
+
+    // 预处理：按节、节内偏移整理符号
+    std::map<std::string, SectionSymbols> symbol_index;
     for (const auto& sym : obj.symbols) {
         if (sym.type != SymbolType::UNDEFINED) {
-            symbol_index[sym.section][sym.offset].push_back(sym);
+            symbol_index[sym.section][sym.offset].push_back(&sym);
         }
     }
 
+    // 动态重定位按地址归入所在的节：区间按起始地址排序后二分查找
+    // 节头优先于同名的程序头；空区间不包含任何地址
+    struct SectionRange {
+        uint64_t start;
+        uint64_t end;
+        std::string name;
+    };
     std::map<std::string, std::pair<uint64_t, uint64_t>> section_ranges;
     for (const auto& shdr : obj.shdrs) {
         section_ranges[shdr.name] = { shdr.addr, shdr.addr + shdr.size };
@@ -47,167 +231,62 @@ void FLE_objdump(const FLEObject& obj, FLEWriter& writer)
     for (const auto& phdr : obj.phdrs) {
         section_ranges.emplace(phdr.name, std::make_pair(phdr.vaddr, phdr.vaddr + phdr.size));
     }
+    std::vector<SectionRange> ranges;
+    for (const auto& [name, range] : section_ranges) {
+        if (range.first < range.second) {
+            ranges.push_back({ range.first, range.second, name });
+        }
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const SectionRange& a, const SectionRange& b) {
+        return a.start < b.start;
+    });
 
     std::map<std::string, std::vector<Relocation>> dyn_relocs_by_section;
     for (const auto& reloc : obj.dyn_relocs) {
-        bool assigned = false;
-        for (const auto& [sec_name, range] : section_ranges) {
-            uint64_t start = range.first;
-            uint64_t end = range.second;
-            if (start <= reloc.offset && reloc.offset < end) {
-                Relocation local = reloc;
-                local.offset = static_cast<size_t>(reloc.offset - start);
-                dyn_relocs_by_section[sec_name].push_back(local);
-                assigned = true;
-                break;
-            }
-        }
-        if (!assigned) {
+        auto it = std::upper_bound(ranges.begin(), ranges.end(), reloc.offset, [](uint64_t offset, const SectionRange& range) {
+            return offset < range.start;
+        });
+        if (it == ranges.begin() || reloc.offset >= std::prev(it)->end) {
             throw std::runtime_error("Dynamic relocation offset " + std::to_string(reloc.offset) + " outside known sections");
         }
+        const SectionRange& range = *std::prev(it);
+        Relocation local = reloc;
+        local.offset = static_cast<size_t>(reloc.offset - range.start);
+        dyn_relocs_by_section[range.name].push_back(local);
     }
 
-    std::vector<std::tuple<std::string, size_t, FLESection>> sections;
-    for (const auto& pair : obj.sections) {
-        const auto& name = pair.first;
-        const auto& section = pair.second;
-        auto shdr = std::find_if(obj.shdrs.begin(), obj.shdrs.end(), [&](const auto& shdr) {
-            return shdr.name == name;
-        });
-        if (shdr == obj.shdrs.end()) {
-            sections.push_back({ name, 0, section });
-            continue;
-        }
-        sections.push_back({ name, shdr->offset, section });
+    // 节按文件偏移排序输出；节头按名字排序后二分查找，没有节头的节偏移为 0
+    std::vector<const SectionHeader*> shdrs_by_name;
+    for (const auto& shdr : obj.shdrs) {
+        shdrs_by_name.push_back(&shdr);
     }
-    std::sort(sections.begin(), sections.end(), [](const auto& a, const auto& b) {
-        return std::get<1>(a) < std::get<1>(b);
+    std::stable_sort(shdrs_by_name.begin(), shdrs_by_name.end(), [](const SectionHeader* a, const SectionHeader* b) {
+        return a->name < b->name;
     });
 
-    // 写入所有段的内容
-    for (const auto& [name, _, section] : sections) {
-        writer.begin_section(name);
-
-        struct RelocForOutput {
-            Relocation reloc;
-            bool dynamic;
-        };
+    std::vector<std::pair<size_t, const std::string*>> sections;
+    for (const auto& [name, section] : obj.sections) {
+        auto shdr = std::lower_bound(shdrs_by_name.begin(), shdrs_by_name.end(), name, [](const SectionHeader* h, const std::string& n) {
+            return h->name < n;
+        });
+        bool found = shdr != shdrs_by_name.end() && (*shdr)->name == name;
+        sections.push_back({ found ? (*shdr)->offset : 0, &name });
+    }
+    std::stable_sort(sections.begin(), sections.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
 
-        std::map<size_t, std::vector<RelocForOutput>> reloc_index;
-        for (const auto& reloc : section.relocs) {
-            reloc_index[reloc.offset].push_back({ reloc, false });
-        }
+    // 各节并发序列化到各自的缓冲区，再按上面的顺序依次写入
+    std::vector<json> section_lines(sections.size());
+    parallel_for(sections.size(), [&](size_t i) {
+        const std::string& name = *sections[i].second;
+        auto symbols_it = symbol_index.find(name);
         auto dyn_it = dyn_relocs_by_section.find(name);
-        if (dyn_it != dyn_relocs_by_section.end()) {
-            for (const auto& reloc : dyn_it->second) {
-                reloc_index[reloc.offset].push_back({ reloc, true });
-            }
-        }
-
-        std::vector<size_t> breaks;
-        for (const auto& sym : obj.symbols) {
-            if (sym.section == name) {
-                breaks.push_back(sym.offset);
-            }
-        }
-        for (const auto& [offset, _] : reloc_index) {
-            breaks.push_back(offset);
-        }
-        std::sort(breaks.begin(), breaks.end());
-        breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
-
-        auto format_reloc = [](const RelocForOutput& entry) -> std::string {
-            auto type_to_tag = [&](RelocationType type, bool dynamic) -> std::string {
-                switch (type) {
-                case RelocationType::R_X86_64_PC32:
-                    return dynamic ? ".dynrel" : ".rel";
-                case RelocationType::R_X86_64_64:
-                    return dynamic ? ".dynabs64" : ".abs64";
-                case RelocationType::R_X86_64_32:
-                    return dynamic ? ".dynabs32" : ".abs";
-                case RelocationType::R_X86_64_32S:
-                    return dynamic ? ".dynabs32" : ".abs32s";
-                case RelocationType::R_X86_64_GOTPCREL:
-                    if (!dynamic)
-                        return ".gotpcrel";
-                    break;
-                }
-                throw std::runtime_error("Unsupported relocation type in objdump");
-            };
-
-            const auto tag = type_to_tag(entry.reloc.type, entry.dynamic);
-            const char sign = entry.reloc.addend < 0 ? '-' : '+';
-            auto abs_addend = static_cast<uint64_t>(std::llabs(entry.reloc.addend));
-
-            std::ostringstream ss;
-            ss << "❓: " << tag << "(" << entry.reloc.symbol << " " << sign << " " << abs_addend << ")";
-            return ss.str();
-        };
-
-        size_t pos = 0;
-        while (pos < section.data.size()) {
-            auto section_it = symbol_index.find(name);
-            if (section_it != symbol_index.end()) {
-                auto offset_it = section_it->second.find(pos);
-                if (offset_it != section_it->second.end()) {
-                    for (const auto& sym : offset_it->second) {
-                        std::string line;
-                        switch (sym.type) {
-                        case SymbolType::LOCAL:
-                            line = "🏷️: " + sym.name;
-                            break;
-                        case SymbolType::WEAK:
-                            line = "📎: " + sym.name;
-                            break;
-                        case SymbolType::GLOBAL:
-                            line = "📤: " + sym.name;
-                            break;
-                        default:
-                            [[unlikely]] throw std::runtime_error("unknown symbol type");
-                        }
-                        line += " " + std::to_string(sym.size) + " " + std::to_string(sym.offset);
-                        writer.write_line(line);
-                    }
-                }
-            }
-
-            auto reloc_it = reloc_index.find(pos);
-            if (reloc_it != reloc_index.end()) {
-                for (const auto& reloc_entry : reloc_it->second) {
-                    writer.write_line(format_reloc(reloc_entry));
-                    size_t reloc_size = (reloc_entry.reloc.type == RelocationType::R_X86_64_64) ? 8 : 4;
-                    pos += reloc_size;
-                }
-                continue;
-            }
-
-            size_t next_break = section.data.size();
-            auto upper = std::upper_bound(breaks.begin(), breaks.end(), pos);
-            if (upper != breaks.end()) {
-                next_break = *upper;
-            }
-
-            while (pos < next_break) {
-                std::stringstream ss;
-                ss << "🔢: ";
-                size_t chunk_size = std::min({
-                    size_t(16),
-                    next_break - pos,
-                    section.data.size() - pos
-                });
-
-                for (size_t i = 0; i < chunk_size; ++i) {
-                    ss << std::hex << std::setw(2) << std::setfill('0')
-                       << static_cast<int>(section.data[pos + i]);
-                    if (i < chunk_size - 1) {
-                        ss << " ";
-                    }
-                }
-                writer.write_line(ss.str());
-                pos += chunk_size;
-            }
-        }
-
-        writer.end_section();
+        section_lines[i] = serialize_section(obj.sections.at(name),
+            symbols_it != symbol_index.end() ? &symbols_it->second : nullptr,
+            dyn_it != dyn_relocs_by_section.end() ? &dyn_it->second : nullptr);
+    });
+    for (size_t i = 0; i < sections.size(); i++) {
+        writer.write_section(*sections[i].second, std::move(section_lines[i]));
     }
 }
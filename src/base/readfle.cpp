@@ -159,6 +159,18 @@ void FLE_readfle(const FLEObject& obj)
                 case RelocationType::R_X86_64_32S:
                     type_str = "R_X86_64_32S";
                     break;
+                case RelocationType::R_X86_64_GOTPCREL:
+                    type_str = "R_X86_64_GOTPCREL";
+                    break;
+                case RelocationType::R_X86_64_TPOFF32:
+                    type_str = "R_X86_64_TPOFF32";
+                    break;
+                case RelocationType::R_X86_64_GOTTPOFF:
+                    type_str = "R_X86_64_GOTTPOFF";
+                    break;
+                case RelocationType::R_X86_64_COPY:
+                    type_str = "R_X86_64_COPY";
+                    break;
                 }
                 std::cout << std::left << std::setw(15) << type_str
                           << std::left << std::setw(max_symbol_name_len) << reloc.symbol
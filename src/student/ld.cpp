@@ -1,4 +1,6 @@
 #include "fle.hpp"
+#include "ldscript.hpp"
+#include "parallel.hpp"
 #include <cassert>
 #include <iostream>
 #include <map>
@@ -9,6 +11,13 @@
 #include <cstdint>
 #include <string>
 #include <set>
+#include <array>
+#include <mutex>
+#include <tuple>
+#include <deque>
+#include <memory_resource>
+#include <string_view>
+#include <sstream>
 
 // 页大小常量
 constexpr size_t PAGE_SIZE = 4096;
@@ -18,36 +27,418 @@ inline size_t align_to(size_t value, size_t alignment) {
     return (value + alignment - 1) & ~(alignment - 1);
 }
 
-// 辅助函数：根据前缀匹配获取输出节名
-static std::string get_output_section_name(const std::string& sec_name) {
+// 辅助函数：根据前缀匹配获取输出节名（返回的视图指向字符串字面量）
+static std::string_view get_output_section_name(std::string_view sec_name) {
     if (sec_name.find(".text") == 0) return ".text";
     if (sec_name.find(".rodata") == 0) return ".rodata";
     if (sec_name.find(".data") == 0) return ".data";
     if (sec_name.find(".bss") == 0) return ".bss";
+    if (sec_name.find(".tdata") == 0) return ".tdata";
+    if (sec_name.find(".tbss") == 0) return ".tbss";
+    if (sec_name == ".plt") return ".plt";
+    if (sec_name == ".got") return ".got";
     return ".data";  // 默认放到 .data
 }
 
-FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& options)
+// 辅助函数：根据节名类别推断节标志
+static uint32_t input_section_flags(std::string_view sec_name) {
+    std::string_view category = get_output_section_name(sec_name);
+    if (category == ".text" || category == ".plt") return SHF::ALLOC | SHF::EXEC;
+    if (category == ".rodata") return static_cast<uint32_t>(SHF::ALLOC);
+    if (category == ".bss") return SHF::ALLOC | SHF::WRITE | SHF::NOBITS;
+    if (category == ".tdata") return SHF::ALLOC | SHF::WRITE | SHF::TLS;
+    if (category == ".tbss") return SHF::ALLOC | SHF::WRITE | SHF::TLS | SHF::NOBITS;
+    return SHF::ALLOC | SHF::WRITE;
+}
+
+// 静态 TLS 块只按 TLS_ALIGN 对齐，要求更高对齐的线程局部变量会得到错位的地址
+static void check_tls_alignment(const std::vector<const FLEObject*>& objects) {
+    for (const FLEObject* obj : objects) {
+        for (const auto& shdr : obj->shdrs) {
+            if ((shdr.flags & SHF::TLS) && shdr.align > TLS_ALIGN) {
+                throw std::runtime_error("Thread-local section " + shdr.name + " in " + obj->name + " needs "
+                    + std::to_string(shdr.align) + "-byte alignment, but the TLS block is only aligned to "
+                    + std::to_string(TLS_ALIGN) + " bytes");
+            }
+        }
+    }
+}
+
+// PLT 项的大小，内容为 generate_plt_stub 生成的 jmp *slot(%rip)
+constexpr size_t PLT_ENTRY_SIZE = 6;
+
+// GOTPCREL 引用处的指令能否改写为直接寻址：
+// mov foo@GOTPCREL(%rip), %reg 和 call/jmp *foo@GOTPCREL(%rip)
+static bool gotpcrel_relaxable(const std::vector<uint8_t>& data, size_t offset) {
+    if (offset < 2 || offset > data.size()) {
+        return false;
+    }
+    uint8_t opcode = data[offset - 2];
+    uint8_t modrm = data[offset - 1];
+    return (opcode == 0x8b && (modrm & 0xc7) == 0x05) || (opcode == 0xff && (modrm == 0x15 || modrm == 0x25));
+}
+
+// 在共享库中查找导出的定义；返回 nullptr 表示库中没有
+static const Symbol* find_shared_definition(const FLEObject& lib, std::string_view name) {
+    for (const Symbol& sym : lib.symbols) {
+        if (sym.name == name && (sym.type == SymbolType::GLOBAL || sym.type == SymbolType::WEAK)) {
+            return &sym;
+        }
+    }
+    return nullptr;
+}
+
+// 共享库中的符号是否为数据（不在可执行节中）
+static bool is_shared_data_symbol(const FLEObject& lib, const Symbol& sym) {
+    for (const auto& shdr : lib.shdrs) {
+        if (shdr.name == sym.section) {
+            return !(shdr.flags & SHF::EXEC);
+        }
+    }
+    return get_output_section_name(sym.section) != ".text";
+}
+
+// 调用图中的一条边：caller 调用 callee，weight 为采样数或调用次数
+struct CallGraphEdge {
+    std::string caller;
+    std::string callee;
+    uint64_t weight;
+};
+
+// 解析 --call-graph-profile：每行 "caller callee weight"，# 之后为注释
+static std::vector<CallGraphEdge> parse_call_graph_profile(const std::string& text) {
+    std::vector<CallGraphEdge> edges;
+    std::istringstream in(text);
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        CallGraphEdge edge;
+        std::string weight, extra;
+        if (!(fields >> edge.caller)) {
+            continue;
+        }
+        if (!(fields >> edge.callee >> weight) || (fields >> extra)) {
+            throw std::runtime_error("call graph profile line " + std::to_string(line_no)
+                + ": expected 'caller callee weight'");
+        }
+        size_t idx = 0;
+        try {
+            edge.weight = std::stoull(weight, &idx, 0);
+        } catch (const std::exception&) {
+            idx = 0;
+        }
+        if (idx == 0 || idx != weight.size()) {
+            throw std::runtime_error("call graph profile line " + std::to_string(line_no)
+                + ": invalid weight '" + weight + "'");
+        }
+        edges.push_back(std::move(edge));
+    }
+    return edges;
+}
+
+// C³ 调用链聚类（Ottoni & Maher, CGO 2017）：
+// 按热度密度从高到低处理每个节，把它所在的簇接到其最重调用者所在簇的末尾，
+// 合并后的簇不超过一页，且密度不会被稀释到原来的 1/8 以下；
+// 最后按密度降序输出各簇。edges 的端点是节名，sizes 给出每个节的大小。
+// 节的编号按名字排序、平局按编号决定，因此结果与输入顺序和线程数无关
+static std::vector<std::string> call_chain_clustering(
+    const std::map<std::pair<std::string, std::string>, uint64_t>& edges,
+    const std::map<std::string, size_t>& sizes) {
+    constexpr size_t MAX_CLUSTER_SIZE = PAGE_SIZE;
+    constexpr uint64_t MAX_DENSITY_DEGRADATION = 8;
+
+    std::map<std::string, size_t> index;
+    for (const auto& [edge, _] : edges) {
+        index.emplace(edge.first, 0);
+        index.emplace(edge.second, 0);
+    }
+    std::vector<std::string> names;
+    for (auto& [name, idx] : index) {
+        idx = names.size();
+        names.push_back(name);
+    }
+
+    struct Cluster {
+        std::vector<size_t> members;
+        size_t size;
+        uint64_t weight;
+    };
+    std::vector<Cluster> clusters(names.size());
+    std::vector<size_t> leader(names.size());
+    std::vector<size_t> best_pred(names.size(), SIZE_MAX);
+    std::vector<uint64_t> best_weight(names.size(), 0);
+    for (size_t i = 0; i < names.size(); i++) {
+        // 空节按 1 字节计，避免密度除零
+        clusters[i] = { { i }, std::max<size_t>(sizes.at(names[i]), 1), 0 };
+        leader[i] = i;
+    }
+    for (const auto& [edge, weight] : edges) {
+        size_t from = index[edge.first];
+        size_t to = index[edge.second];
+        clusters[to].weight += weight;
+        if (weight > best_weight[to]) {
+            best_weight[to] = weight;
+            best_pred[to] = from;
+        }
+    }
+
+    // a 的密度 (weight / size) 是否高于 b；交叉相乘避免浮点误差
+    auto denser = [](uint64_t wa, size_t sa, uint64_t wb, size_t sb) {
+        return static_cast<unsigned __int128>(wa) * sb > static_cast<unsigned __int128>(wb) * sa;
+    };
+
+    std::vector<size_t> order(names.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return denser(clusters[a].weight, clusters[a].size, clusters[b].weight, clusters[b].size);
+    });
+
+    for (size_t node : order) {
+        if (best_pred[node] == SIZE_MAX) {
+            continue;
+        }
+        size_t from = leader[best_pred[node]];
+        size_t to = leader[node];
+        if (from == to) {
+            continue;
+        }
+        Cluster& pred = clusters[from];
+        Cluster& self = clusters[to];
+        if (pred.size + self.size > MAX_CLUSTER_SIZE) {
+            continue;
+        }
+        // 合并后的密度不能低于调用者簇原密度的 1/MAX_DENSITY_DEGRADATION
+        if (denser(pred.weight, pred.size * MAX_DENSITY_DEGRADATION,
+                pred.weight + self.weight, pred.size + self.size)) {
+            continue;
+        }
+        for (size_t member : self.members) {
+            leader[member] = from;
+        }
+        pred.members.insert(pred.members.end(), self.members.begin(), self.members.end());
+        pred.size += self.size;
+        pred.weight += self.weight;
+        self.members.clear();
+    }
+
+    std::vector<size_t> sorted_clusters;
+    for (size_t i = 0; i < clusters.size(); i++) {
+        if (!clusters[i].members.empty()) {
+            sorted_clusters.push_back(i);
+        }
+    }
+    std::stable_sort(sorted_clusters.begin(), sorted_clusters.end(), [&](size_t a, size_t b) {
+        return denser(clusters[a].weight, clusters[a].size, clusters[b].weight, clusters[b].size);
+    });
+
+    std::vector<std::string> result;
+    for (size_t c : sorted_clusters) {
+        for (size_t member : clusters[c].members) {
+            result.push_back(names[member]);
+        }
+    }
+    return result;
+}
+
+// 符号优先级规则：强符号 > 弱符号（先出现者优先）> 未定义
+// 返回 false 表示强符号重复定义；replace 表示新符号取代现有符号
+static bool merge_symbol(SymbolType existing, SymbolType incoming, bool& replace) {
+    replace = false;
+    if (existing == SymbolType::GLOBAL && 
+        incoming == SymbolType::GLOBAL) {
+        return false;
+    }
+    
+    if (existing == SymbolType::WEAK && 
+        incoming == SymbolType::GLOBAL) {
+        replace = true;
+    }
+    else if (existing == SymbolType::GLOBAL && 
+             incoming == SymbolType::WEAK) {
+        // 保持现有强符号不变
+    }
+    else if (existing == SymbolType::WEAK && 
+             incoming == SymbolType::WEAK) {
+        // 保持现有的弱符号
+    }
+    else if (existing == SymbolType::UNDEFINED &&
+             incoming != SymbolType::UNDEFINED) {
+        replace = true;
+    }
+    else if (existing != SymbolType::UNDEFINED &&
+             incoming == SymbolType::UNDEFINED) {
+        // 保持现有定义不变
+    }
+    return true;
+}
+
+// 链接期间使用的符号：节名和符号名只是视图，指向输入对象、链接脚本或字符串字面量，
+// 表放在内存池中时不会为每个符号分配和释放字符串；写入输出对象时才转为 Symbol
+struct LinkSymbol {
+    SymbolType type;
+    std::string_view section;
+    size_t offset;
+    size_t size;
+    std::string_view name;
+    
+    Symbol to_symbol() const {
+        return { type, std::string(section), offset, size, std::string(name) };
+    }
+};
+
+// 并发符号表：按符号名哈希分片，每个分片独立加锁
+// 插入阶段只收集候选定义；归并阶段按输入顺序依次应用 merge_symbol，
+// 因此结果（包括报告哪个重复定义）与线程到达顺序无关
+// 候选只引用输入目标文件中的符号，每个分片的表分配在自己的内存池中
+class ShardedSymbolTable {
+public:
+    struct Candidate {
+        size_t obj_idx; // 所在目标文件的输入顺序
+        size_t sym_idx; // 在目标文件符号表中的顺序
+        const Symbol* sym;
+        size_t offset; // 加上节合并偏移后的符号偏移
+    };
+    
+    using Batch = std::array<std::pmr::vector<Candidate>, 64>;
+    
+    // 按分片整理一个目标文件的候选
+    static void add(Batch& batch, const Candidate& candidate) {
+        batch[shard_of(candidate.sym->name)].push_back(candidate);
+    }
+    
+    // 插入一个目标文件的全部候选，每个分片只加一次锁
+    void insert(const Batch& batch) {
+        for (size_t i = 0; i < NUM_SHARDS; i++) {
+            if (batch[i].empty()) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            for (const auto& candidate : batch[i]) {
+                shards[i].candidates[candidate.sym->name].push_back(candidate);
+            }
+        }
+    }
+    
+    // 结果的键和值都引用输入目标文件中的字符串
+    std::pmr::unordered_map<std::string_view, LinkSymbol> resolve(std::pmr::memory_resource* arena) {
+        struct Conflict {
+            size_t obj_idx = SIZE_MAX;
+            size_t sym_idx = SIZE_MAX;
+            std::string_view name;
+        };
+        std::array<std::pmr::vector<const Candidate*>, NUM_SHARDS> resolved;
+        std::array<Conflict, NUM_SHARDS> conflicts;
+        
+        parallel_for(NUM_SHARDS, [&](size_t i) {
+            Shard& shard = shards[i];
+            resolved[i] = std::pmr::vector<const Candidate*>(&shard.arena);
+            std::pmr::vector<std::string_view> names(&shard.arena);
+            for (const auto& [name, _] : shard.candidates) {
+                names.push_back(name);
+            }
+            std::sort(names.begin(), names.end());
+            
+            for (const auto& name : names) {
+                auto& list = shard.candidates.find(name)->second;
+                std::sort(list.begin(), list.end(), [](const Candidate& a, const Candidate& b) {
+                    return std::tie(a.obj_idx, a.sym_idx) < std::tie(b.obj_idx, b.sym_idx);
+                });
+                
+                const Candidate* winner = &list.front();
+                for (size_t k = 1; k < list.size(); k++) {
+                    bool replace;
+                    if (!merge_symbol(winner->sym->type, list[k].sym->type, replace)) {
+                        // 记录顺序执行时最先遇到的冲突
+                        Conflict& c = conflicts[i];
+                        if (std::tie(list[k].obj_idx, list[k].sym_idx) < std::tie(c.obj_idx, c.sym_idx)) {
+                            c = { list[k].obj_idx, list[k].sym_idx, name };
+                        }
+                        break;
+                    }
+                    if (replace) {
+                        winner = &list[k];
+                    }
+                }
+                resolved[i].push_back(winner);
+            }
+        });
+        
+        const Conflict* first = nullptr;
+        for (const auto& c : conflicts) {
+            if (!c.name.empty() && (!first || std::tie(c.obj_idx, c.sym_idx) < std::tie(first->obj_idx, first->sym_idx))) {
+                first = &c;
+            }
+        }
+        if (first) {
+            throw std::runtime_error("Multiple definition of strong symbol: " + std::string(first->name));
+        }
+        
+        std::pmr::unordered_map<std::string_view, LinkSymbol> result(arena);
+        for (const auto& shard_result : resolved) {
+            for (const Candidate* winner : shard_result) {
+                const Symbol& sym = *winner->sym;
+                result.emplace(sym.name, LinkSymbol { sym.type, sym.section, winner->offset, sym.size, sym.name });
+            }
+        }
+        return result;
+    }
+    
+private:
+    static constexpr size_t NUM_SHARDS = std::tuple_size<Batch>::value;
+    
+    struct Shard {
+        std::mutex mutex;
+        std::pmr::monotonic_buffer_resource arena;
+        std::pmr::unordered_map<std::string_view, std::pmr::vector<Candidate>> candidates { &arena };
+    };
+    std::array<Shard, NUM_SHARDS> shards;
+    
+    static size_t shard_of(std::string_view name) {
+        return std::hash<std::string_view> {}(name) % NUM_SHARDS;
+    }
+};
+
+// 参与链接的输入：普通目标文件和被选中的归档成员（按输入顺序），以及共享库
+struct LinkInputs {
+    std::vector<const FLEObject*> objects;
+    std::vector<const FLEObject*> shared_libs;
+    std::vector<bool> shared_as_needed;
+    std::pmr::set<std::string_view> undefined_symbols; // 选取成员后仍未定义的符号
+};
+
+// 任务七：处理归档文件（静态库）的按需链接
+static LinkInputs collect_link_inputs(const std::vector<const FLEObject*>& objects, const LinkerOptions& options,
+    std::pmr::memory_resource* arena)
 {
-    // 任务七：处理归档文件（静态库）的按需链接
-    std::vector<FLEObject> ordinary_objs;
-    std::vector<FLEObject> archives;
+    LinkInputs inputs { {}, {}, {}, std::pmr::set<std::string_view>(arena) };
     
-    for (const auto& obj : objects) {
+    // 输入对象只以指针引用，不复制符号、重定位和节数据
+    std::vector<const FLEObject*> archives;
+    for (size_t i = 0; i < objects.size(); i++) {
+        const FLEObject& obj = *objects[i];
         if (obj.type == ".ar") {
-            archives.push_back(obj);
+            archives.push_back(&obj);
+        } else if (obj.type == ".so") {
+            // 共享库不参与合并，只用于符号解析和记录依赖
+            inputs.shared_libs.push_back(&obj);
+            inputs.shared_as_needed.push_back(i < options.as_needed.size() && options.as_needed[i]);
         } else {
-            ordinary_objs.push_back(obj);
+            inputs.objects.push_back(&obj);
         }
     }
     
     // 用于记录已解析的符号和未解析的符号
-    std::set<std::string> resolved_symbols;
-    std::set<std::string> undefined_symbols;
+    std::pmr::set<std::string_view> resolved_symbols(arena);
+    std::pmr::set<std::string_view>& undefined_symbols = inputs.undefined_symbols;
     
     // 首先，扫描所有普通对象，收集符号定义和引用
-    for (const auto& obj : ordinary_objs) {
-        for (const Symbol& sym : obj.symbols) {
+    for (const FLEObject* obj : inputs.objects) {
+        for (const Symbol& sym : obj->symbols) {
             if (sym.name.empty() || sym.name[0] == '.' || sym.type == SymbolType::LOCAL) {
                 continue;
             }
@@ -66,13 +457,11 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
     
     // 按需链接：循环直到没有新的符号被解析
     bool changed;
-    std::vector<FLEObject> all_objects = ordinary_objs;
-    
     do {
         changed = false;
         
         for (auto archive_it = archives.begin(); archive_it != archives.end(); ) {
-            const FLEObject& archive = *archive_it;
+            const FLEObject& archive = **archive_it;
             bool archive_used = false;
             
             for (const auto& member : archive.members) {
@@ -88,7 +477,7 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                 }
                 
                 if (defines_needed) {
-                    all_objects.push_back(member);
+                    inputs.objects.push_back(&member);
                     archive_used = true;
                     changed = true;
                     
@@ -116,37 +505,123 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
         }
     } while (changed);
     
+    return inputs;
+}
+
+// 输入按地址传入各阶段，批量链接时多个链接可以共享同一份只读输入
+static std::vector<const FLEObject*> object_pointers(const std::vector<FLEObject>& objects)
+{
+    std::vector<const FLEObject*> pointers;
+    pointers.reserve(objects.size());
+    for (const auto& obj : objects) {
+        pointers.push_back(&obj);
+    }
+    return pointers;
+}
+
+FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& options)
+{
+    return FLE_ld(object_pointers(objects), options);
+}
+
+FLEObject FLE_ld(const std::vector<const FLEObject*>& objects, const LinkerOptions& options)
+{
+    // 链接期间的内部表都从这个内存池分配：分配只移动指针，释放是空操作，
+    // FLE_ld 返回时整块归还，而不是逐个节点释放
+    std::pmr::monotonic_buffer_resource arena(64 * 1024);
+    // 表的键尽量是指向输入对象或字符串字面量的视图；其他来源的名字先复制到内存池中
+    auto intern = [&](std::string_view str) -> std::string_view {
+        char* copy = static_cast<char*>(arena.allocate(str.size() + 1, 1));
+        std::copy(str.begin(), str.end(), copy);
+        return { copy, str.size() };
+    };
+    
+    LinkInputs inputs = collect_link_inputs(objects, options, &arena);
+    const std::vector<const FLEObject*>& all_objects = inputs.objects;
+    const std::vector<const FLEObject*>& shared_libs = inputs.shared_libs;
+    const std::vector<bool>& shared_as_needed = inputs.shared_as_needed;
+    const std::pmr::set<std::string_view>& undefined_symbols = inputs.undefined_symbols;
+    
     if (all_objects.empty()) {
         throw std::runtime_error("No input objects to link");
     }
+    check_tls_alignment(all_objects);
     
     // 创建输出对象
     FLEObject output;
     output.name = options.outputFile;
     output.type = options.shared ? ".so" : ".exe";
     
+    // 共享库：按输入顺序导出符号，先出现的定义优先
+    std::pmr::unordered_map<std::string_view, size_t> shared_symbols(&arena);
+    for (size_t lib_idx = 0; lib_idx < shared_libs.size(); lib_idx++) {
+        for (const Symbol& sym : shared_libs[lib_idx]->symbols) {
+            if (sym.name.empty() || sym.name[0] == '.') {
+                continue;
+            }
+            if (sym.type == SymbolType::GLOBAL || sym.type == SymbolType::WEAK) {
+                shared_symbols.emplace(sym.name, lib_idx);
+            }
+        }
+    }
+    
+    // 只有解析了至少一个未定义引用的库才算被使用（--as-needed）
+    std::vector<bool> shared_used(shared_libs.size(), false);
+    for (const auto& name : undefined_symbols) {
+        auto it = shared_symbols.find(name);
+        if (it != shared_symbols.end()) {
+            shared_used[it->second] = true;
+        }
+    }
+    
+    for (size_t lib_idx = 0; lib_idx < shared_libs.size(); lib_idx++) {
+        const std::string& lib_name = shared_libs[lib_idx]->name;
+        if (shared_used[lib_idx] || !shared_as_needed[lib_idx]) {
+            if (std::find(output.needed.begin(), output.needed.end(), lib_name) == output.needed.end()) {
+                output.needed.push_back(lib_name);
+            }
+        } else {
+            std::cerr << "ld: --as-needed: dropping unused library " << lib_name << std::endl;
+        }
+    }
+    
     // 1. 合并节内容
-    std::map<std::string, FLESection> merged_sections;
-    std::map<std::pair<size_t, std::string>, size_t> section_offsets;
-    std::map<std::pair<size_t, std::string>, size_t> section_sizes;
+    // 合并后的节内容会复制到输出节中，数据和重定位使用默认分配器
+    std::map<std::string, FLESection, std::less<>> merged_sections;
+    // 键中的节名指向输入对象中的字符串
+    std::pmr::map<std::pair<size_t, std::string_view>, size_t> section_offsets(&arena);
+    std::pmr::map<std::pair<size_t, std::string_view>, size_t> section_sizes(&arena);
     
     for (size_t obj_idx = 0; obj_idx < all_objects.size(); obj_idx++) {
-        const FLEObject& obj = all_objects[obj_idx];
+        const FLEObject& obj = *all_objects[obj_idx];
         
         for (const auto& [sec_name, sec] : obj.sections) {
             if (merged_sections.find(sec_name) == merged_sections.end()) {
                 FLESection new_sec;
                 new_sec.name = sec_name;
                 new_sec.has_symbols = sec.has_symbols;
+                new_sec.nobits = sec.nobits;
                 merged_sections[sec_name] = new_sec;
             }
             
-            size_t current_offset = merged_sections[sec_name].data.size();
+            FLESection& merged_sec = merged_sections[sec_name];
+            size_t current_offset = merged_sec.size;
             section_offsets[{obj_idx, sec_name}] = current_offset;
-            section_sizes[{obj_idx, sec_name}] = sec.data.size();
+            section_sizes[{obj_idx, sec_name}] = sec.size;
             
-            FLESection& merged_sec = merged_sections[sec_name];
-            merged_sec.data.insert(merged_sec.data.end(), sec.data.begin(), sec.data.end());
+            // NOBITS 节只累加大小；同名节中混有带内容的节时才展开为零字节
+            if (merged_sec.nobits && !sec.nobits) {
+                merged_sec.data.resize(merged_sec.size, 0);
+                merged_sec.nobits = false;
+            }
+            if (sec.nobits) {
+                if (!merged_sec.nobits) {
+                    merged_sec.data.insert(merged_sec.data.end(), sec.size, 0);
+                }
+            } else {
+                merged_sec.data.insert(merged_sec.data.end(), sec.data.begin(), sec.data.end());
+            }
+            merged_sec.size += sec.size;
             
             for (const auto& reloc : sec.relocs) {
                 Relocation new_reloc = reloc;
@@ -157,212 +632,529 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
     }
     
     // 2. 建立全局符号表（任务四：符号冲突处理）
-    std::unordered_map<std::string, Symbol> global_symbols;
+    // 各目标文件并行插入分片符号表，之后按输入顺序归并
     std::vector<Symbol> output_symbols;
+    ShardedSymbolTable symbol_table;
     
     // 为每个目标文件建立本地符号表
-    std::vector<std::unordered_map<std::string, Symbol>> local_symbols_by_obj(all_objects.size());
+    // 内存池不是线程安全的，并行处理时每个目标文件使用自己的内存池
+    std::deque<std::pmr::monotonic_buffer_resource> object_arenas(all_objects.size());
+    std::vector<std::pmr::unordered_map<std::string_view, LinkSymbol>> local_symbols_by_obj;
+    std::vector<std::pmr::vector<Symbol>> local_labels_by_obj;
+    local_symbols_by_obj.reserve(all_objects.size());
+    local_labels_by_obj.reserve(all_objects.size());
+    for (auto& object_arena : object_arenas) {
+        local_symbols_by_obj.emplace_back(&object_arena);
+        local_labels_by_obj.emplace_back(&object_arena);
+    }
     
-    for (size_t obj_idx = 0; obj_idx < all_objects.size(); obj_idx++) {
-        const FLEObject& obj = all_objects[obj_idx];
+    parallel_for(all_objects.size(), [&](size_t obj_idx) {
+        const FLEObject& obj = *all_objects[obj_idx];
+        std::pmr::memory_resource* object_arena = &object_arenas[obj_idx];
+        ShardedSymbolTable::Batch batch;
+        for (auto& shard_batch : batch) {
+            shard_batch = std::pmr::vector<ShardedSymbolTable::Candidate>(object_arena);
+        }
         
-        for (const Symbol& sym : obj.symbols) {
+        for (size_t sym_idx = 0; sym_idx < obj.symbols.size(); sym_idx++) {
+            const Symbol& sym = obj.symbols[sym_idx];
+            size_t offset = sym.offset;
+            if (!sym.section.empty()) {
+                auto offset_it = section_offsets.find({ obj_idx, sym.section });
+                if (offset_it != section_offsets.end()) {
+                    offset += offset_it->second;
+                }
+            }
+            
             // 处理本地标签符号（以.开头的符号）
             if (!sym.name.empty() && sym.name[0] == '.') {
+                local_symbols_by_obj[obj_idx][sym.name] = LinkSymbol { sym.type, sym.section, offset, sym.size, sym.name };
                 Symbol new_sym = sym;
-                if (!sym.section.empty() && section_offsets.find({obj_idx, sym.section}) != section_offsets.end()) {
-                    new_sym.offset += section_offsets[{obj_idx, sym.section}];
-                }
-                
-                local_symbols_by_obj[obj_idx][sym.name] = new_sym;
+                new_sym.offset = offset;
                 new_sym.type = SymbolType::LOCAL;
-                output_symbols.push_back(new_sym);
+                local_labels_by_obj[obj_idx].push_back(new_sym);
                 continue;
             }
             
             // 处理全局符号
-            Symbol new_sym = sym;
-            if (!sym.section.empty() && section_offsets.find({obj_idx, sym.section}) != section_offsets.end()) {
-                new_sym.offset += section_offsets[{obj_idx, sym.section}];
-            }
-            
-            auto it = global_symbols.find(sym.name);
-            
-            if (it == global_symbols.end()) {
-                global_symbols[sym.name] = new_sym;
-            } else {
-                Symbol& existing_sym = it->second;
-                
-                if (existing_sym.type == SymbolType::GLOBAL && 
-                    new_sym.type == SymbolType::GLOBAL) {
-                    throw std::runtime_error("Multiple definition of strong symbol: " + sym.name);
-                }
-                
-                if (existing_sym.type == SymbolType::WEAK && 
-                    new_sym.type == SymbolType::GLOBAL) {
-                    existing_sym = new_sym;
-                }
-                else if (existing_sym.type == SymbolType::GLOBAL && 
-                         new_sym.type == SymbolType::WEAK) {
-                    // 保持现有强符号不变
+            ShardedSymbolTable::add(batch, { obj_idx, sym_idx, &sym, offset });
+        }
+        
+        symbol_table.insert(batch);
+    });
+    
+    for (const auto& labels : local_labels_by_obj) {
+        output_symbols.insert(output_symbols.end(), labels.begin(), labels.end());
+    }
+    
+    std::pmr::unordered_map<std::string_view, LinkSymbol> global_symbols = symbol_table.resolve(&arena);
+    
+    auto is_defined = [&](std::string_view name) {
+        auto it = global_symbols.find(name);
+        return it != global_symbols.end() && it->second.type != SymbolType::UNDEFINED;
+    };
+    
+    // 复制重定位：可执行文件用绝对或 PC 相对寻址直接访问共享库中的数据时，
+    // 在可执行文件中为该变量预留空间，加载器把库中的初值复制过来，
+    // 库自己的引用也绑定到这份副本上，访问就不必经过 GOT 或文本重定位
+    // FLE 的动态重定位内嵌在节内容中，所以副本放在带内容的 .dynbss 节而不是 .bss 中
+    // 名字指向共享库中的定义
+    std::pmr::vector<std::string_view> copy_symbols(&arena);
+    if (!options.shared) {
+        std::pmr::set<std::string_view> seen(&arena);
+        for (const auto& [sec_name, sec] : merged_sections) {
+            for (const auto& reloc : sec.relocs) {
+                if (reloc.type != RelocationType::R_X86_64_PC32 && reloc.type != RelocationType::R_X86_64_32
+                    && reloc.type != RelocationType::R_X86_64_32S && reloc.type != RelocationType::R_X86_64_64) {
+                    continue;
                 }
-                else if (existing_sym.type == SymbolType::WEAK && 
-                         new_sym.type == SymbolType::WEAK) {
-                    // 保持现有的弱符号
+                if (reloc.symbol.empty() || reloc.symbol[0] == '.' || is_defined(reloc.symbol) || seen.count(reloc.symbol)) {
+                    continue;
                 }
-                else if (existing_sym.type == SymbolType::UNDEFINED &&
-                         new_sym.type != SymbolType::UNDEFINED) {
-                    existing_sym = new_sym;
+                auto lib_it = shared_symbols.find(reloc.symbol);
+                if (lib_it == shared_symbols.end()) {
+                    continue;
                 }
-                else if (existing_sym.type != SymbolType::UNDEFINED &&
-                         new_sym.type == SymbolType::UNDEFINED) {
-                    // 保持现有定义不变
+                const FLEObject& lib = *shared_libs[lib_it->second];
+                const Symbol* def = find_shared_definition(lib, reloc.symbol);
+                // 函数仍通过动态重定位绑定；大小未知的变量无法复制
+                if (def && def->size != 0 && is_shared_data_symbol(lib, *def)) {
+                    seen.insert(def->name);
+                    copy_symbols.push_back(def->name);
                 }
             }
         }
     }
+    if (!copy_symbols.empty()) {
+        FLESection& dynbss = merged_sections[".dynbss"];
+        dynbss.name = ".dynbss";
+        dynbss.has_symbols = true;
+        for (const auto& name : copy_symbols) {
+            const FLEObject& lib = *shared_libs[shared_symbols.find(name)->second];
+            size_t size = find_shared_definition(lib, name)->size;
+            size_t offset = align_to(dynbss.data.size(), size >= 16 ? 16 : 8);
+            dynbss.data.resize(offset + size, 0);
+            global_symbols[name] = LinkSymbol { SymbolType::GLOBAL, ".dynbss", offset, size, name };
+        }
+        dynbss.size = dynbss.data.size();
+    }
     
-    // 3. 将节按标准类别合并（任务五：多段布局）
-    std::map<std::string, FLESection> output_sections;
-    std::map<std::string, std::string> sec_to_output;
-    std::map<std::string, size_t> sec_offset_in_output;
-    
-    // 定义标准节类别
-    std::vector<std::pair<std::string, std::vector<std::string>>> section_categories = {
-        {".text", {".text"}},
-        {".rodata", {".rodata"}},
-        {".data", {".data"}},
-        {".bss", {".bss"}}
+    // GOT 与 PLT：所有输入目标文件中对同一符号的引用共用一个 GOT 项，
+    // 只有被 call/jmp 调用的共享库函数才生成 PLT 项（jmp *slot(%rip)，6 字节），
+    // 可执行文件中已定义的目标直接调用，不经过 PLT
+    // 共享库中导出的符号可能被可执行文件中的定义（包括复制重定位的副本）取代，
+    // 因此库内对它们的 GOTPCREL 引用也经由加载时填写的 GOT 项
+    auto is_plt_call = [&](const std::vector<uint8_t>& data, const Relocation& reloc) {
+        if (options.shared || reloc.type != RelocationType::R_X86_64_PC32 || reloc.symbol.empty()
+            || reloc.symbol[0] == '.' || is_defined(reloc.symbol) || !shared_symbols.count(reloc.symbol)) {
+            return false;
+        }
+        return reloc.offset >= 1 && reloc.offset <= data.size()
+            && (data[reloc.offset - 1] == 0xe8 || data[reloc.offset - 1] == 0xe9);
+    };
+    auto needs_got_slot = [&](const std::vector<uint8_t>& data, const Relocation& reloc) {
+        if (reloc.type != RelocationType::R_X86_64_GOTPCREL || reloc.symbol.empty() || reloc.symbol[0] == '.') {
+            return false;
+        }
+        if (options.shared || !is_defined(reloc.symbol)) {
+            return true;
+        }
+        return !gotpcrel_relaxable(data, reloc.offset);
     };
     
-    // 收集所有原节名
-    std::vector<std::string> all_input_sections;
-    for (const auto& [sec_name, _] : merged_sections) {
-        all_input_sections.push_back(sec_name);
+    // 名字指向 merged_sections 中重定位的符号名，合并之后这些重定位不再改动
+    std::pmr::vector<std::string_view> got_symbols(&arena);
+    std::pmr::unordered_map<std::string_view, size_t> got_slots(&arena);
+    std::pmr::vector<std::string_view> plt_symbols(&arena);
+    std::pmr::unordered_map<std::string_view, size_t> plt_entries(&arena);
+    auto add_got_slot = [&](std::string_view name) {
+        if (got_slots.emplace(name, got_symbols.size()).second) {
+            got_symbols.push_back(name);
+        }
+    };
+    for (const auto& [sec_name, sec] : merged_sections) {
+        for (const auto& reloc : sec.relocs) {
+            if (needs_got_slot(sec.data, reloc)) {
+                add_got_slot(reloc.symbol);
+            } else if (is_plt_call(sec.data, reloc)) {
+                add_got_slot(reloc.symbol);
+                if (plt_entries.emplace(reloc.symbol, plt_symbols.size()).second) {
+                    plt_symbols.push_back(reloc.symbol);
+                }
+            }
+        }
+    }
+    if (!got_symbols.empty()) {
+        FLESection& got = merged_sections[".got"];
+        got.name = ".got";
+        got.data.assign(got_symbols.size() * 8, 0);
+        got.size = got.data.size();
+    }
+    if (!plt_symbols.empty()) {
+        FLESection& plt = merged_sections[".plt"];
+        plt.name = ".plt";
+        plt.data.assign(plt_symbols.size() * PLT_ENTRY_SIZE, 0);
+        plt.size = plt.data.size();
     }
-    std::sort(all_input_sections.begin(), all_input_sections.end());
     
-    // 处理每个类别
-    for (const auto& [category_name, prefixes] : section_categories) {
-        FLESection out_sec;
-        out_sec.name = category_name;
-        out_sec.has_symbols = false;
-        
-        size_t current_offset = 0;
-        
-        for (const auto& sec_name : all_input_sections) {
-            bool belongs = false;
-            for (const auto& prefix : prefixes) {
-                if (sec_name.find(prefix) == 0) {
-                    belongs = true;
-                    break;
-                }
+    // 3. 按链接脚本将节归入输出节并布局（任务五、六：多段布局与 4KB 对齐）
+    // 未给出 -T 时使用等价于经典 .text/.rodata/.data/.bss 布局的默认脚本
+    LinkerScript script = parse_linker_script(options.script.empty() ? DEFAULT_LINKER_SCRIPT : options.script);
+    
+    // 输出节最终成为输出对象的节，使用默认分配器
+    std::map<std::string, FLESection> output_sections;
+    // 输入节名指向 merged_sections 的键，输出节名复制到内存池中：
+    // 下面会向 script.commands 追加孤立节的命令，不能引用其中的字符串
+    std::pmr::map<std::string_view, std::string_view> sec_to_output(&arena);
+    std::pmr::map<std::string_view, size_t> sec_offset_in_output(&arena);
+    
+    // 先确定每个输入节归属的规则：按脚本顺序，第一个匹配的规则优先
+    // 输入节按节名顺序遍历（merged_sections 按节名排序）
+    // 键为 (输出节命令下标, 节内语句下标)
+    std::pmr::map<std::pair<size_t, size_t>, std::pmr::vector<std::string_view>> matched_inputs(&arena);
+    std::pmr::map<std::string_view, size_t> script_out_secs(&arena);
+    for (size_t cmd_idx = 0; cmd_idx < script.commands.size(); cmd_idx++) {
+        const ScriptCommand& cmd = script.commands[cmd_idx];
+        if (cmd.kind != ScriptCommand::Kind::OutputSection) {
+            continue;
+        }
+        std::string_view out_name = intern(cmd.name);
+        if (!script_out_secs.emplace(out_name, cmd_idx).second) {
+            throw std::runtime_error("linker script: duplicate output section " + cmd.name);
+        }
+        for (size_t item_idx = 0; item_idx < cmd.body.size(); item_idx++) {
+            const ScriptCommand& item = cmd.body[item_idx];
+            if (item.kind != ScriptCommand::Kind::Input) {
+                continue;
             }
-            
-            if (belongs) {
-                const FLESection& src_sec = merged_sections[sec_name];
-                
-                sec_to_output[sec_name] = category_name;
-                sec_offset_in_output[sec_name] = current_offset;
-                
-                if (category_name != ".bss") {
-                    out_sec.data.insert(out_sec.data.end(), src_sec.data.begin(), src_sec.data.end());
+            for (const auto& [sec_name, _] : merged_sections) {
+                if (sec_to_output.count(sec_name)) {
+                    continue;
                 }
-                
-                for (const auto& reloc : src_sec.relocs) {
-                    Relocation new_reloc = reloc;
-                    new_reloc.offset += current_offset;
-                    out_sec.relocs.push_back(new_reloc);
+                for (const auto& pattern : item.patterns) {
+                    if (script_pattern_match(pattern, sec_name)) {
+                        sec_to_output[sec_name] = out_name;
+                        matched_inputs[{ cmd_idx, item_idx }].push_back(sec_name);
+                        break;
+                    }
                 }
-                
-                current_offset += src_sec.data.size();
             }
         }
-        
-        if (!out_sec.data.empty() || !out_sec.relocs.empty() || category_name == ".bss") {
-            output_sections[category_name] = out_sec;
-        }
     }
     
-    // 处理剩余未分类的节
-    for (const auto& sec_name : all_input_sections) {
-        if (sec_to_output.find(sec_name) == sec_to_output.end()) {
-            sec_to_output[sec_name] = ".data";
-            if (output_sections.find(".data") == output_sections.end()) {
-                FLESection data_sec;
-                data_sec.name = ".data";
-                data_sec.has_symbols = false;
-                output_sections[".data"] = data_sec;
+    // 剩余未匹配的节按类别追加到同名输出节末尾，没有则在脚本末尾新建
+    std::pmr::map<std::string_view, std::pmr::vector<std::string_view>> orphans_by_output(&arena);
+    for (const auto& [sec_name, _] : merged_sections) {
+        if (!sec_to_output.count(sec_name)) {
+            std::string_view out_name = get_output_section_name(sec_name);
+            sec_to_output[sec_name] = out_name;
+            orphans_by_output[out_name].push_back(sec_name);
+        }
+    }
+    for (auto& [out_name, orphans] : orphans_by_output) {
+        auto it = script_out_secs.find(out_name);
+        if (it == script_out_secs.end()) {
+            ScriptCommand cmd;
+            cmd.kind = ScriptCommand::Kind::OutputSection;
+            cmd.name = out_name;
+            script.commands.push_back(cmd);
+            it = script_out_secs.emplace(out_name, script.commands.size() - 1).first;
+        }
+        ScriptCommand& out_cmd = script.commands[it->second];
+        ScriptCommand orphan_item;
+        orphan_item.kind = ScriptCommand::Kind::Input;
+        out_cmd.body.push_back(orphan_item);
+        matched_inputs[{ it->second, out_cmd.body.size() - 1 }] = std::move(orphans);
+    }
+
+    // 3.5 按调用图剖析重排可执行输入节（--call-graph-profile）
+    // 函数映射到所在的输入节（-ffunction-sections 时每个函数一节），聚类后的热节
+    // 排在各自输入语句的最前面，其余节保持默认的相对顺序
+    if (!options.call_graph_profile.empty()) {
+        // 同名时全局定义优先于局部定义，同类中先出现者优先
+        std::map<std::string, std::string> function_sections;
+        for (bool want_local : { false, true }) {
+            for (const FLEObject* obj : all_objects) {
+                for (const Symbol& sym : obj->symbols) {
+                    if (sym.section.empty() || sym.name.empty() || sym.name[0] == '.'
+                        || sym.type == SymbolType::UNDEFINED || (sym.type == SymbolType::LOCAL) != want_local
+                        || !(input_section_flags(sym.section) & SHF::EXEC)) {
+                        continue;
+                    }
+                    function_sections.emplace(sym.name, sym.section);
+                }
             }
-            
-            size_t current_offset = output_sections[".data"].data.size();
-            sec_offset_in_output[sec_name] = current_offset;
-            
-            const FLESection& src_sec = merged_sections[sec_name];
-            output_sections[".data"].data.insert(output_sections[".data"].data.end(), 
-                                                src_sec.data.begin(), src_sec.data.end());
-            
-            for (const auto& reloc : src_sec.relocs) {
-                Relocation new_reloc = reloc;
-                new_reloc.offset += current_offset;
-                output_sections[".data"].relocs.push_back(new_reloc);
+        }
+
+        std::map<std::pair<std::string, std::string>, uint64_t> section_edges;
+        std::set<std::string> unknown;
+        for (const auto& edge : parse_call_graph_profile(options.call_graph_profile)) {
+            auto from = function_sections.find(edge.caller);
+            auto to = function_sections.find(edge.callee);
+            if (from == function_sections.end() || to == function_sections.end()) {
+                unknown.insert(from == function_sections.end() ? edge.caller : edge.callee);
+                continue;
+            }
+            if (from->second != to->second && edge.weight != 0) {
+                section_edges[{ from->second, to->second }] += edge.weight;
             }
         }
+        for (const auto& name : unknown) {
+            std::cerr << "ld: call-graph-profile: no function named " << name << std::endl;
+        }
+
+        std::map<std::string, size_t> section_sizes_by_name;
+        for (const auto& [edge, _] : section_edges) {
+            section_sizes_by_name[edge.first] = merged_sections[edge.first].size;
+            section_sizes_by_name[edge.second] = merged_sections[edge.second].size;
+        }
+        std::vector<std::string> hot_order = call_chain_clustering(section_edges, section_sizes_by_name);
+        std::pmr::map<std::string_view, size_t> rank(&arena);
+        for (size_t i = 0; i < hot_order.size(); i++) {
+            rank[hot_order[i]] = i;
+        }
+        
+        // 热节覆盖的页数：每个输出节从页边界开始，输入节依次紧密排列
+        auto count_hot_pages = [&]() {
+            std::set<std::pair<size_t, size_t>> pages;
+            std::map<size_t, size_t> out_offsets;
+            for (const auto& [key, inputs] : matched_inputs) {
+                size_t& offset = out_offsets[key.first];
+                for (const auto& sec_name : inputs) {
+                    size_t size = merged_sections.find(sec_name)->second.size;
+                    if (rank.count(sec_name) && size != 0) {
+                        for (size_t page = offset / PAGE_SIZE; page <= (offset + size - 1) / PAGE_SIZE; page++) {
+                            pages.emplace(key.first, page);
+                        }
+                    }
+                    offset += size;
+                }
+            }
+            return pages.size();
+        };
+        size_t default_pages = count_hot_pages();
+        for (auto& [_, inputs] : matched_inputs) {
+            std::stable_sort(inputs.begin(), inputs.end(), [&](std::string_view a, std::string_view b) {
+                auto ra = rank.find(a);
+                auto rb = rank.find(b);
+                if (rb == rank.end()) {
+                    return ra != rank.end();
+                }
+                return ra != rank.end() && ra->second < rb->second;
+            });
+        }
+        std::cerr << "ld: call-graph-profile: " << hot_order.size() << " hot sections, hot set "
+                  << count_hot_pages() << " pages (default layout " << default_pages << " pages)" << std::endl;
     }
+
+    // 4. 计算每个输出节的虚拟地址（任务六：4KB对齐）
+    // 加载器按输出节分别映射，因此每个输出节的起始地址都对齐到页
+    // 此后不再追加脚本命令，输出节名和脚本符号名直接指向链接脚本中的字符串
+    std::pmr::map<std::string_view, uint64_t> section_vaddrs(&arena);
+    std::pmr::map<std::string_view, size_t> section_file_offsets(&arena);
+    std::pmr::map<std::string_view, size_t> section_mem_sizes(&arena);
+    std::pmr::map<std::string_view, uint32_t> section_flags(&arena);
+    std::pmr::vector<std::string_view> out_sec_names(&arena);
+    std::pmr::map<std::string_view, uint64_t> script_symbols(&arena);
     
-    // 4. 计算每个输出节在内存中的虚拟地址偏移（任务六：4KB对齐）
-    std::map<std::string, size_t> section_vaddr_offsets;
-    std::map<std::string, size_t> section_file_offsets;
-    std::map<std::string, size_t> section_mem_sizes;
+    auto lookup_script_symbol = [&](const std::string& name) -> uint64_t {
+        auto it = script_symbols.find(name);
+        if (it == script_symbols.end()) {
+            throw std::runtime_error("linker script: undefined symbol " + name + " in expression");
+        }
+        return it->second;
+    };
     
-    uint64_t base_addr = 0x400000;
-    uint64_t current_vaddr_offset = 0;
+    uint64_t dot = 0x400000;
     size_t current_file_offset = 0;
     
-    std::vector<std::string> output_order = {".text", ".rodata", ".data", ".bss"};
-    std::vector<std::string> out_sec_names;
-    
-    for (const auto& sec_name : output_order) {
-        if (output_sections.find(sec_name) != output_sections.end()) {
-            out_sec_names.push_back(sec_name);
-            
-            current_vaddr_offset = align_to(current_vaddr_offset, PAGE_SIZE);
-            section_vaddr_offsets[sec_name] = current_vaddr_offset;
-            
-            if (sec_name == ".bss") {
-                size_t bss_size = 0;
-                for (const auto& [input_sec_name, input_sec] : merged_sections) {
-                    if (input_sec_name.find(".bss") == 0) {
-                        bss_size += input_sec.data.size();
+    for (size_t cmd_idx = 0; cmd_idx < script.commands.size(); cmd_idx++) {
+        const ScriptCommand& cmd = script.commands[cmd_idx];
+        if (cmd.kind == ScriptCommand::Kind::SetDot) {
+            dot = eval_script_expr(cmd.expr, dot, lookup_script_symbol);
+            continue;
+        }
+        if (cmd.kind == ScriptCommand::Kind::Assign) {
+            script_symbols[cmd.name] = eval_script_expr(cmd.expr, dot, lookup_script_symbol);
+            continue;
+        }
+        if (cmd.kind != ScriptCommand::Kind::OutputSection) {
+            continue;
+        }
+        
+        // 输出节的属性由其中的输入节决定；没有输入节时按节名推断
+        std::pmr::vector<std::string_view> members(&arena);
+        for (size_t item_idx = 0; item_idx < cmd.body.size(); item_idx++) {
+            auto it = matched_inputs.find({ cmd_idx, item_idx });
+            if (it != matched_inputs.end()) {
+                members.insert(members.end(), it->second.begin(), it->second.end());
+            }
+        }
+        uint32_t flags = static_cast<uint32_t>(SHF::ALLOC);
+        bool nobits = true;
+        size_t tls_members = 0;
+        for (const auto& sec_name : members) {
+            uint32_t member_flags = input_section_flags(sec_name);
+            flags |= member_flags & ~static_cast<uint32_t>(SHF::NOBITS);
+            nobits = nobits && merged_sections.find(sec_name)->second.nobits;
+            tls_members += (member_flags & SHF::TLS) ? 1 : 0;
+        }
+        // 加载器按节名找到 TLS 模板，线程局部的输入节只能放在 .tdata 和 .tbss 中
+        if (tls_members != 0 && (tls_members != members.size() || (cmd.name != ".tdata" && cmd.name != ".tbss"))) {
+            throw std::runtime_error("Thread-local input sections must be placed alone in .tdata or .tbss, not " + cmd.name);
+        }
+        if (members.empty()) {
+            flags = input_section_flags(cmd.name);
+            nobits = flags & SHF::NOBITS;
+        }
+        if (nobits) {
+            flags |= SHF::NOBITS;
+        }
+        
+        uint64_t saved_dot = dot;
+        uint64_t start = dot;
+        bool explicit_start = true;
+        auto start_it = options.section_start.find(cmd.name);
+        if (start_it != options.section_start.end()) {
+            start = start_it->second;
+        } else if (cmd.has_addr) {
+            start = eval_script_expr(cmd.expr, dot, lookup_script_symbol);
+        } else {
+            explicit_start = false;
+        }
+        if (explicit_start && start % PAGE_SIZE != 0) {
+            throw std::runtime_error("Start address of output section " + cmd.name + " must be page aligned");
+        }
+        if (cmd.has_align) {
+            uint64_t alignment = eval_script_expr(cmd.align, dot, lookup_script_symbol);
+            if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+                throw std::runtime_error("linker script: ALIGN requires a power of two");
+            }
+            start = align_to(start, alignment);
+        }
+        start = align_to(start, PAGE_SIZE);
+        dot = start;
+        
+        FLESection out_sec;
+        out_sec.name = cmd.name;
+        out_sec.has_symbols = false;
+        
+        // 在节内移动位置计数器时，非 NOBITS 节用 0 填充
+        auto advance_to = [&](uint64_t target) {
+            if (target < dot) {
+                throw std::runtime_error("linker script: cannot move location counter backwards in " + cmd.name);
+            }
+            if (!nobits) {
+                out_sec.data.insert(out_sec.data.end(), target - dot, 0);
+            }
+            dot = target;
+        };
+        
+        for (size_t item_idx = 0; item_idx < cmd.body.size(); item_idx++) {
+            const ScriptCommand& item = cmd.body[item_idx];
+            if (item.kind == ScriptCommand::Kind::SetDot) {
+                advance_to(eval_script_expr(item.expr, dot, lookup_script_symbol));
+            } else if (item.kind == ScriptCommand::Kind::Assign) {
+                script_symbols[item.name] = eval_script_expr(item.expr, dot, lookup_script_symbol);
+            } else if (item.kind == ScriptCommand::Kind::Input) {
+                auto it = matched_inputs.find({ cmd_idx, item_idx });
+                if (it == matched_inputs.end()) {
+                    continue;
+                }
+                for (const auto& sec_name : it->second) {
+                    const FLESection& src_sec = merged_sections.find(sec_name)->second;
+                    size_t current_offset = dot - start;
+                    sec_offset_in_output[sec_name] = current_offset;
+                    
+                    if (!nobits) {
+                        if (src_sec.nobits) {
+                            out_sec.data.insert(out_sec.data.end(), src_sec.size, 0);
+                        } else {
+                            out_sec.data.insert(out_sec.data.end(), src_sec.data.begin(), src_sec.data.end());
+                        }
+                    }
+                    
+                    for (const auto& reloc : src_sec.relocs) {
+                        Relocation new_reloc = reloc;
+                        new_reloc.offset += current_offset;
+                        out_sec.relocs.push_back(new_reloc);
                     }
+                    
+                    dot += src_sec.size;
                 }
-                
-                section_file_offsets[sec_name] = 0;
-                section_mem_sizes[sec_name] = bss_size;
-            } else {
-                section_file_offsets[sec_name] = current_file_offset;
-                size_t data_size = output_sections[sec_name].data.size();
-                section_mem_sizes[sec_name] = data_size;
-                current_file_offset += data_size;
             }
-            
-            current_vaddr_offset += section_mem_sizes[sec_name];
         }
+        out_sec.nobits = nobits;
+        out_sec.size = dot - start;
+        
+        if (out_sec.size == 0 && out_sec.relocs.empty() && cmd.name != ".bss") {
+            // 空输出节不占用地址空间
+            dot = saved_dot;
+            continue;
+        }
+        
+        out_sec_names.push_back(cmd.name);
+        section_vaddrs[cmd.name] = start;
+        section_mem_sizes[cmd.name] = dot - start;
+        section_flags[cmd.name] = flags;
+        if (nobits) {
+            section_file_offsets[cmd.name] = 0;
+        } else {
+            section_file_offsets[cmd.name] = current_file_offset;
+            current_file_offset += out_sec.data.size();
+        }
+        output_sections[cmd.name] = out_sec;
     }
     
-    // 5. 创建 merged section 到虚拟地址偏移的映射
-    // 这是关键！每个 merged section 在最终虚拟地址空间中的起始偏移
-    std::map<std::string, size_t> merged_sec_vaddr;
+    // 输出节之间不能重叠
+    for (size_t i = 0; i < out_sec_names.size(); i++) {
+        for (size_t j = i + 1; j < out_sec_names.size(); j++) {
+            std::string_view a = out_sec_names[i];
+            std::string_view b = out_sec_names[j];
+            if (section_vaddrs[a] < section_vaddrs[b] + section_mem_sizes[b]
+                && section_vaddrs[b] < section_vaddrs[a] + section_mem_sizes[a]) {
+                throw std::runtime_error("Output sections " + std::string(a) + " and " + std::string(b) + " overlap");
+            }
+        }
+    }
+    
+    // 5. 创建 merged section 到虚拟地址的映射
+    // 这是关键！每个 merged section 在最终虚拟地址空间中的起始地址
+    std::pmr::map<std::string_view, uint64_t> merged_sec_vaddr(&arena);
     for (const auto& [sec_name, _] : merged_sections) {
-        std::string out_sec = get_output_section_name(sec_name);
-        if (section_vaddr_offsets.find(out_sec) != section_vaddr_offsets.end()) {
-            auto offset_it = sec_offset_in_output.find(sec_name);
-            if (offset_it != sec_offset_in_output.end()) {
-                merged_sec_vaddr[sec_name] = section_vaddr_offsets[out_sec] + offset_it->second;
-            } else {
-                merged_sec_vaddr[sec_name] = section_vaddr_offsets[out_sec];
+        std::string_view out_sec = sec_to_output[sec_name];
+        if (section_vaddrs.count(out_sec)) {
+            merged_sec_vaddr[sec_name] = section_vaddrs[out_sec] + sec_offset_in_output[sec_name];
+        }
+    }
+    
+    // 线程局部存储模板：.tdata 的初始内容之后是 .tbss
+    auto tls_section_size = [&](std::string_view name) -> uint64_t {
+        auto it = section_mem_sizes.find(name);
+        return it != section_mem_sizes.end() ? it->second : 0;
+    };
+    TLSLayout tls = tls_layout(tls_section_size(".tdata"), tls_section_size(".tbss"));
+    if (options.shared && tls.block_size != 0) {
+        throw std::runtime_error("Thread-local storage is only supported in executables");
+    }
+    
+    // 变量相对线程指针的偏移（x86-64 上为负数）
+    auto tls_tp_offset = [&](uint64_t sym_vaddr, const std::string& name) -> int64_t {
+        for (const char* sec_name : { ".tdata", ".tbss" }) {
+            auto it = section_vaddrs.find(sec_name);
+            if (it == section_vaddrs.end() || sym_vaddr < it->second || sym_vaddr > it->second + section_mem_sizes[sec_name]) {
+                continue;
             }
+            uint64_t template_offset = sym_vaddr - it->second + (sec_name == std::string_view(".tbss") ? tls.tbss_offset : 0);
+            return static_cast<int64_t>(template_offset) - static_cast<int64_t>(tls.block_size);
         }
+        throw std::runtime_error("TLS relocation against non-thread-local symbol " + name);
+    };
+    
+    // 映像的最低地址，用于没有所属输出节的偏移
+    uint64_t image_base = out_sec_names.empty() ? 0x400000 : section_vaddrs[out_sec_names.front()];
+    for (const auto& sec_name : out_sec_names) {
+        image_base = std::min(image_base, section_vaddrs[sec_name]);
     }
     
     // 6. 更新符号的节和偏移
@@ -371,12 +1163,11 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
         if (!sym.section.empty()) {
             auto it = sec_to_output.find(sym.section);
             if (it != sec_to_output.end()) {
-                std::string out_sec_name = it->second;
                 auto offset_it = sec_offset_in_output.find(sym.section);
                 if (offset_it != sec_offset_in_output.end()) {
                     sym.offset += offset_it->second;
                 }
-                sym.section = out_sec_name;
+                sym.section = it->second;
             } else {
                 // 使用前缀匹配
                 sym.section = get_output_section_name(sym.section);
@@ -384,10 +1175,25 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
         }
     }
     
+    // 链接脚本中赋值的符号覆盖目标文件中的同名符号
+    // 落在某个输出节范围内的记为该节的符号，其余为绝对符号
+    for (const auto& [name, value] : script_symbols) {
+        LinkSymbol sym { SymbolType::GLOBAL, {}, value, 0, name };
+        for (const auto& sec_name : out_sec_names) {
+            uint64_t start = section_vaddrs[sec_name];
+            if (value >= start && value <= start + section_mem_sizes[sec_name]) {
+                sym.section = sec_name;
+                sym.offset = value - start;
+                break;
+            }
+        }
+        global_symbols[name] = sym;
+    }
+    
     // 将最终确定的符号添加到输出符号表
     for (const auto& [name, sym] : global_symbols) {
         if (sym.type != SymbolType::UNDEFINED) {
-            output_symbols.push_back(sym);
+            output_symbols.push_back(sym.to_symbol());
         }
     }
     
@@ -396,22 +1202,62 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
         if (sym.type == SymbolType::LOCAL && !sym.section.empty()) {
             auto it = sec_to_output.find(sym.section);
             if (it != sec_to_output.end()) {
-                std::string out_sec_name = it->second;
                 auto offset_it = sec_offset_in_output.find(sym.section);
                 if (offset_it != sec_offset_in_output.end()) {
                     sym.offset += offset_it->second;
                 }
-                sym.section = out_sec_name;
+                sym.section = it->second;
             } else {
                 sym.section = get_output_section_name(sym.section);
             }
         }
     }
     
+    auto symbol_vaddr = [&](const LinkSymbol& sym) -> uint64_t {
+        if (sym.section.empty()) {
+            return sym.offset;
+        }
+        auto it = section_vaddrs.find(sym.section);
+        return (it != section_vaddrs.end() ? it->second : image_base) + sym.offset;
+    };
+    
+    for (const auto& name : copy_symbols) {
+        output.dyn_relocs.push_back({ RelocationType::R_X86_64_COPY, symbol_vaddr(global_symbols[name]), std::string(name), 0 });
+    }
+    
+    // 可执行文件中已定义的符号直接填入 GOT 项，其余由加载器填写
+    uint64_t got_vaddr = merged_sec_vaddr.count(".got") ? merged_sec_vaddr[".got"] : 0;
+    for (size_t slot = 0; slot < got_symbols.size(); slot++) {
+        std::string_view name = got_symbols[slot];
+        uint64_t slot_vaddr = got_vaddr + slot * 8;
+        if (!options.shared && is_defined(name)) {
+            FLESection& out_sec = output_sections[std::string(sec_to_output[".got"])];
+            size_t offset = sec_offset_in_output[".got"] + slot * 8;
+            *reinterpret_cast<uint64_t*>(&out_sec.data[offset]) = symbol_vaddr(global_symbols[name]);
+        } else if (options.shared || shared_symbols.count(name)) {
+            output.dyn_relocs.push_back({ RelocationType::R_X86_64_64, slot_vaddr, std::string(name), 0 });
+        } else {
+            throw std::runtime_error("Undefined symbol: " + std::string(name));
+        }
+    }
+    
+    uint64_t plt_vaddr = merged_sec_vaddr.count(".plt") ? merged_sec_vaddr[".plt"] : 0;
+    for (size_t entry = 0; entry < plt_symbols.size(); entry++) {
+        uint64_t entry_vaddr = plt_vaddr + entry * PLT_ENTRY_SIZE;
+        uint64_t slot_vaddr = got_vaddr + got_slots[plt_symbols[entry]] * 8;
+        std::vector<uint8_t> stub = generate_plt_stub(static_cast<int32_t>(slot_vaddr - (entry_vaddr + PLT_ENTRY_SIZE)));
+        FLESection& out_sec = output_sections[std::string(sec_to_output[".plt"])];
+        std::copy(stub.begin(), stub.end(), out_sec.data.begin() + sec_offset_in_output[".plt"] + entry * PLT_ENTRY_SIZE);
+    }
+    
     // 7. 处理重定位（任务二、三：重定位计算）
+    // 引用共享库中的符号时，生成动态重定位交给加载器处理
+    // 已转为动态重定位或经 GOT 解析的条目记录在这里，处理完一个输出节后从其重定位表中删除
+    std::pmr::set<size_t> dynamic_reloc_offsets(&arena);
     for (auto& [out_sec_name, out_sec] : output_sections) {
+        dynamic_reloc_offsets.clear();
         for (Relocation& reloc : out_sec.relocs) {
-            uint64_t P = base_addr + section_vaddr_offsets[out_sec_name] + reloc.offset;
+            uint64_t P = section_vaddrs[out_sec_name] + reloc.offset;
             uint64_t sym_vaddr = 0;
             
             // 检查是否是本地标签（以.开头的符号）
@@ -419,7 +1265,7 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                 bool found = false;
                 
                 // 找到这个重定位原本在哪个merged section中
-                std::string orig_merged_sec;
+                std::string_view orig_merged_sec;
                 size_t reloc_offset_in_merged = reloc.offset;
                 
                 for (const auto& [sec_name, _] : merged_sections) {
@@ -428,7 +1274,7 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                         auto sec_offset_it = sec_offset_in_output.find(sec_name);
                         if (sec_offset_it != sec_offset_in_output.end()) {
                             size_t sec_offset = sec_offset_it->second;
-                            size_t sec_size = merged_sections[sec_name].data.size();
+                            size_t sec_size = merged_sections[sec_name].size;
                             if (reloc.offset >= sec_offset && reloc.offset < sec_offset + sec_size) {
                                 orig_merged_sec = sec_name;
                                 reloc_offset_in_merged = reloc.offset - sec_offset;
@@ -454,16 +1300,16 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                             reloc_offset_in_merged < start_offset + size) {
                             auto local_sym_it = local_symbols_by_obj[obj_idx].find(reloc.symbol);
                             if (local_sym_it != local_symbols_by_obj[obj_idx].end()) {
-                                const Symbol& target_sym = local_sym_it->second;
+                                const LinkSymbol& target_sym = local_sym_it->second;
                                 
                                 // 使用 merged_sec_vaddr 获取符号所在 merged section 的虚拟地址
                                 auto vaddr_it = merged_sec_vaddr.find(target_sym.section);
                                 if (vaddr_it != merged_sec_vaddr.end()) {
-                                    sym_vaddr = base_addr + vaddr_it->second + target_sym.offset;
+                                    sym_vaddr = vaddr_it->second + target_sym.offset;
                                 } else {
                                     // fallback: 用前缀匹配
-                                    std::string target_out_sec = get_output_section_name(target_sym.section);
-                                    sym_vaddr = base_addr + section_vaddr_offsets[target_out_sec] + target_sym.offset;
+                                    auto out_vaddr_it = section_vaddrs.find(get_output_section_name(target_sym.section));
+                                    sym_vaddr = (out_vaddr_it != section_vaddrs.end() ? out_vaddr_it->second : 0) + target_sym.offset;
                                 }
                                 found = true;
                                 break;
@@ -476,31 +1322,55 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                     throw std::runtime_error("Undefined local symbol: " + reloc.symbol);
                 }
             } else {
+                // 经 GOT 项或 PLT 项间接访问：它们的地址在链接时已知，与位置无关
+                bool via_got = needs_got_slot(out_sec.data, reloc);
+                bool via_plt = !via_got && is_plt_call(out_sec.data, reloc);
+                if (via_got || via_plt) {
+                    uint64_t target = via_got ? got_vaddr + got_slots[reloc.symbol] * 8
+                                              : plt_vaddr + plt_entries[reloc.symbol] * PLT_ENTRY_SIZE;
+                    int64_t value = static_cast<int64_t>(target) + reloc.addend - static_cast<int64_t>(P);
+                    if (value > INT32_MAX || value < INT32_MIN) {
+                        throw std::runtime_error(std::string(via_got ? "R_X86_64_GOTPCREL" : "R_X86_64_PC32")
+                            + " relocation overflow");
+                    }
+                    *reinterpret_cast<int32_t*>(&out_sec.data[reloc.offset]) = static_cast<int32_t>(value);
+                    dynamic_reloc_offsets.insert(reloc.offset);
+                    continue;
+                }
+                
                 // 普通符号 - 现在 global_symbols 已经被正确更新
                 auto sym_it = global_symbols.find(reloc.symbol);
                 if (sym_it == global_symbols.end() || sym_it->second.type == SymbolType::UNDEFINED) {
-                    if (options.shared) {
+                    if (reloc.type == RelocationType::R_X86_64_TPOFF32 || reloc.type == RelocationType::R_X86_64_GOTTPOFF) {
+                        throw std::runtime_error("Thread-local symbol " + reloc.symbol + " must be defined in the executable");
+                    }
+                    if (shared_symbols.count(reloc.symbol) || options.shared) {
+                        if (!(section_flags[out_sec_name] & SHF::NOBITS)) {
+                            output.dyn_relocs.push_back({ reloc.type, P, reloc.symbol, reloc.addend });
+                            dynamic_reloc_offsets.insert(reloc.offset);
+                        }
                         continue;
                     }
                     throw std::runtime_error("Undefined symbol: " + reloc.symbol);
                 }
                 
-                const Symbol& target_sym = sym_it->second;
+                const LinkSymbol& target_sym = sym_it->second;
                 if (!target_sym.section.empty()) {
                     // target_sym.section 现在是输出节名（已在步骤6中更新）
-                    auto sec_offset_it = section_vaddr_offsets.find(target_sym.section);
-                    if (sec_offset_it != section_vaddr_offsets.end()) {
-                        sym_vaddr = base_addr + sec_offset_it->second + target_sym.offset;
+                    auto sec_vaddr_it = section_vaddrs.find(target_sym.section);
+                    if (sec_vaddr_it != section_vaddrs.end()) {
+                        sym_vaddr = sec_vaddr_it->second + target_sym.offset;
                     } else {
-                        sym_vaddr = base_addr + target_sym.offset;
+                        sym_vaddr = image_base + target_sym.offset;
                     }
                 } else {
-                    sym_vaddr = base_addr + target_sym.offset;
+                    // 链接脚本定义的绝对符号
+                    sym_vaddr = target_sym.offset;
                 }
             }
             
-            // 对于.bss节，不写入文件
-            if (out_sec_name == ".bss") {
+            // 对于 NOBITS 节（如 .bss），不写入文件
+            if (section_flags[out_sec_name] & SHF::NOBITS) {
                 continue;
             }
             
@@ -510,6 +1380,9 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                 case RelocationType::R_X86_64_32:
                 case RelocationType::R_X86_64_32S:
                 case RelocationType::R_X86_64_PC32:
+                case RelocationType::R_X86_64_GOTPCREL:
+                case RelocationType::R_X86_64_TPOFF32:
+                case RelocationType::R_X86_64_GOTTPOFF:
                     reloc_size = 4;
                     break;
                 case RelocationType::R_X86_64_64:
@@ -562,10 +1435,70 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
                     break;
                 }
                     
+                case RelocationType::R_X86_64_GOTPCREL:
+                {
+                    // 没有分配 GOT 项的引用：地址静态可知，改写为直接寻址
+                    // mov -> lea；call *slot -> addr32 call；jmp *slot -> nop; jmp
+                    if (!gotpcrel_relaxable(out_sec.data, reloc.offset)) {
+                        throw std::runtime_error("Unsupported instruction for R_X86_64_GOTPCREL against " + reloc.symbol);
+                    }
+                    uint8_t* insn = &out_sec.data[reloc.offset - 2];
+                    if (insn[0] == 0x8b) {
+                        insn[0] = 0x8d;
+                    } else if (insn[1] == 0x15) {
+                        insn[0] = 0x67;
+                        insn[1] = 0xe8;
+                    } else {
+                        insn[0] = 0x90;
+                        insn[1] = 0xe9;
+                    }
+                    int64_t value = static_cast<int64_t>(sym_vaddr) + reloc.addend - static_cast<int64_t>(P);
+                    if (value > INT32_MAX || value < INT32_MIN) {
+                        throw std::runtime_error("R_X86_64_GOTPCREL relocation overflow");
+                    }
+                    *reinterpret_cast<int32_t*>(&out_sec.data[reloc.offset]) = static_cast<int32_t>(value);
+                    dynamic_reloc_offsets.insert(reloc.offset);
+                    break;
+                }
+                    
+                case RelocationType::R_X86_64_TPOFF32:
+                {
+                    int64_t value = tls_tp_offset(sym_vaddr, reloc.symbol) + reloc.addend;
+                    if (value > INT32_MAX || value < INT32_MIN) {
+                        throw std::runtime_error("R_X86_64_TPOFF32 relocation overflow");
+                    }
+                    *reinterpret_cast<int32_t*>(&out_sec.data[reloc.offset]) = static_cast<int32_t>(value);
+                    break;
+                }
+                    
+                case RelocationType::R_X86_64_GOTTPOFF:
+                {
+                    // 可执行文件中的 TP 偏移在链接时已知，不需要 GOT 项：
+                    // 把 mov/add foo@gottpoff(%rip), %reg 改写为 mov/add $tpoff, %reg
+                    uint8_t* insn = reloc.offset >= 3 ? &out_sec.data[reloc.offset - 3] : nullptr;
+                    if (!insn || (insn[0] & 0xfb) != 0x48 || (insn[2] & 0xc7) != 0x05
+                        || (insn[1] != 0x8b && insn[1] != 0x03)) {
+                        throw std::runtime_error("Unsupported instruction for R_X86_64_GOTTPOFF against " + reloc.symbol);
+                    }
+                    uint8_t reg = (insn[2] >> 3) & 7;
+                    insn[0] = 0x48 | ((insn[0] & 0x04) ? 0x01 : 0x00); // REX.R -> REX.B
+                    insn[1] = insn[1] == 0x8b ? 0xc7 : 0x81;
+                    insn[2] = 0xc0 | reg;
+                    int64_t value = tls_tp_offset(sym_vaddr, reloc.symbol);
+                    *reinterpret_cast<int32_t*>(&out_sec.data[reloc.offset]) = static_cast<int32_t>(value);
+                    break;
+                }
+                    
                 default:
                     throw std::runtime_error("Unsupported relocation type: " + std::to_string(static_cast<int>(reloc.type)));
             }
         }
+        
+        // 已转为动态重定位或经 GOT 解析的条目不再保留在节重定位表中
+        auto& relocs = out_sec.relocs;
+        relocs.erase(std::remove_if(relocs.begin(), relocs.end(), [&](const Relocation& reloc) {
+            return dynamic_reloc_offsets.count(reloc.offset) > 0;
+        }), relocs.end());
     }
     
     // 8. 对于静态可执行文件，清除已应用的重定位
@@ -579,6 +1512,30 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
     output.sections = output_sections;
     output.symbols = output_symbols;
     
+    // 9.5 按地址排序的符号索引：函数和对象符号，不含标签、未定义和线程局部符号
+    // 名字指向 output_symbols 中的字符串
+    std::pmr::vector<std::tuple<uint64_t, std::string_view, uint64_t>> indexed_symbols(&arena);
+    std::pmr::map<std::string_view, uint32_t> index_name_ids(&arena);
+    for (const Symbol& sym : output_symbols) {
+        auto vaddr_it = section_vaddrs.find(sym.section);
+        if (sym.type == SymbolType::UNDEFINED || sym.name.empty() || sym.name[0] == '.'
+            || vaddr_it == section_vaddrs.end() || (section_flags.at(sym.section) & SHF::TLS)) {
+            continue;
+        }
+        indexed_symbols.emplace_back(vaddr_it->second + sym.offset, sym.name, sym.size);
+        index_name_ids.emplace(sym.name, 0);
+    }
+    // 条目按 (地址, 名字) 排序，名字按字典序编号，结果与符号的收集顺序无关
+    std::sort(indexed_symbols.begin(), indexed_symbols.end());
+    indexed_symbols.erase(std::unique(indexed_symbols.begin(), indexed_symbols.end()), indexed_symbols.end());
+    for (auto& [name, id] : index_name_ids) {
+        id = static_cast<uint32_t>(output.symbol_index.names.size());
+        output.symbol_index.names.push_back(std::string(name));
+    }
+    for (const auto& [start, name, size] : indexed_symbols) {
+        output.symbol_index.entries.push_back({ start, size, index_name_ids[name] });
+    }
+    
     // 10. 设置节头（任务六：正确权限）
     output.shdrs.clear();
     
@@ -587,21 +1544,9 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
         shdr.name = sec_name;
         shdr.type = 1;
         
-        shdr.flags = static_cast<uint32_t>(SHF::ALLOC);
-        
-        if (sec_name == ".text") {
-            shdr.flags |= static_cast<uint32_t>(SHF::EXEC);
-        } else if (sec_name == ".rodata") {
-            // 只读，不可写
-        } else {
-            shdr.flags |= static_cast<uint32_t>(SHF::WRITE);
-        }
-        
-        if (sec_name == ".bss") {
-            shdr.flags |= static_cast<uint32_t>(SHF::NOBITS);
-        }
-        
-        shdr.addr = base_addr + section_vaddr_offsets[sec_name];
+        // 权限来自输出节中输入节的类别（.text 可执行，.rodata 只读，其余可写）
+        shdr.flags = section_flags[sec_name];
+        shdr.addr = section_vaddrs[sec_name];
         shdr.offset = section_file_offsets[sec_name];
         shdr.size = section_mem_sizes[sec_name];
         
@@ -614,15 +1559,15 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
     for (const auto& sec_name : out_sec_names) {
         ProgramHeader phdr;
         phdr.name = sec_name;
-        phdr.vaddr = base_addr + section_vaddr_offsets[sec_name];
+        phdr.vaddr = section_vaddrs[sec_name];
         phdr.size = section_mem_sizes[sec_name];
         
-        if (sec_name == ".text") {
-            phdr.flags = static_cast<uint32_t>(PHF::R) | static_cast<uint32_t>(PHF::X);
-        } else if (sec_name == ".rodata") {
-            phdr.flags = static_cast<uint32_t>(PHF::R);
-        } else {
-            phdr.flags = static_cast<uint32_t>(PHF::R) | static_cast<uint32_t>(PHF::W);
+        phdr.flags = static_cast<uint32_t>(PHF::R);
+        if (section_flags[sec_name] & SHF::EXEC) {
+            phdr.flags |= PHF::X;
+        }
+        if (section_flags[sec_name] & SHF::WRITE) {
+            phdr.flags |= PHF::W;
         }
         
         output.phdrs.push_back(phdr);
@@ -631,26 +1576,107 @@ FLEObject FLE_ld(const std::vector<FLEObject>& objects, const LinkerOptions& opt
     // 12. 设置入口点
     auto entry_sym = global_symbols.find(options.entryPoint);
     if (entry_sym != global_symbols.end()) {
-        const Symbol& sym = entry_sym->second;
-        uint64_t entry_vaddr = base_addr;
+        const LinkSymbol& sym = entry_sym->second;
+        uint64_t entry_vaddr = sym.offset;
         if (!sym.section.empty()) {
-            auto sec_offset_it = section_vaddr_offsets.find(sym.section);
-            if (sec_offset_it != section_vaddr_offsets.end()) {
-                entry_vaddr += sec_offset_it->second + sym.offset;
-            } else {
-                entry_vaddr += sym.offset;
-            }
-        } else {
-            entry_vaddr += sym.offset;
+            auto sec_vaddr_it = section_vaddrs.find(sym.section);
+            entry_vaddr += sec_vaddr_it != section_vaddrs.end() ? sec_vaddr_it->second : image_base;
         }
         output.entry = entry_vaddr;
     } else {
-        if (section_vaddr_offsets.find(".text") != section_vaddr_offsets.end()) {
-            output.entry = base_addr + section_vaddr_offsets[".text"];
+        if (section_vaddrs.find(".text") != section_vaddrs.end()) {
+            output.entry = section_vaddrs[".text"];
         } else {
-            output.entry = base_addr;
+            output.entry = image_base;
         }
     }
     
     return output;
-}
\ No newline at end of file
+}
+
+std::vector<std::string> FLE_ld_check(const std::vector<FLEObject>& objects, const LinkerOptions& options)
+{
+    return FLE_ld_check(object_pointers(objects), options);
+}
+
+std::vector<std::string> FLE_ld_check(const std::vector<const FLEObject*>& objects, const LinkerOptions& options)
+{
+    std::pmr::monotonic_buffer_resource arena(64 * 1024);
+    
+    // 与完整链接相同的归档成员选取
+    LinkInputs inputs = collect_link_inputs(objects, options, &arena);
+    
+    // 链接脚本赋值的符号在布局时才有值，但同样可以满足引用
+    std::pmr::set<std::string_view> script_symbols(&arena);
+    LinkerScript script = parse_linker_script(options.script.empty() ? DEFAULT_LINKER_SCRIPT : options.script);
+    for (const auto& cmd : script.commands) {
+        if (cmd.kind == ScriptCommand::Kind::Assign) {
+            script_symbols.insert(cmd.name);
+        }
+        for (const auto& item : cmd.body) {
+            if (item.kind == ScriptCommand::Kind::Assign) {
+                script_symbols.insert(item.name);
+            }
+        }
+    }
+    
+    std::pmr::set<std::string_view> shared_symbols(&arena);
+    for (const FLEObject* lib : inputs.shared_libs) {
+        for (const Symbol& sym : lib->symbols) {
+            if (sym.type == SymbolType::GLOBAL || sym.type == SymbolType::WEAK) {
+                shared_symbols.insert(sym.name);
+            }
+        }
+    }
+    
+    // 按首次出现的顺序记录每个符号的强定义、是否有定义以及第一个引用者
+    struct SymbolUse {
+        std::pmr::vector<const FLEObject*> strong_defs;
+        bool defined = false;
+        const FLEObject* first_ref = nullptr;
+    };
+    std::pmr::vector<std::string_view> order(&arena);
+    std::pmr::unordered_map<std::string_view, SymbolUse> uses(&arena);
+    
+    for (const FLEObject* obj : inputs.objects) {
+        for (const Symbol& sym : obj->symbols) {
+            if (sym.name.empty() || sym.name[0] == '.' || sym.type == SymbolType::LOCAL) {
+                continue;
+            }
+            auto [it, inserted] = uses.try_emplace(sym.name, SymbolUse { std::pmr::vector<const FLEObject*>(&arena) });
+            if (inserted) {
+                order.push_back(sym.name);
+            }
+            SymbolUse& use = it->second;
+            if (sym.type == SymbolType::GLOBAL) {
+                use.strong_defs.push_back(obj);
+            }
+            if (sym.type != SymbolType::UNDEFINED) {
+                use.defined = true;
+            } else if (!use.first_ref) {
+                use.first_ref = obj;
+            }
+        }
+    }
+    
+    std::vector<std::string> errors;
+    for (const auto& name : order) {
+        const SymbolUse& use = uses.find(name)->second;
+        if (use.strong_defs.size() > 1) {
+            std::string where;
+            for (const FLEObject* obj : use.strong_defs) {
+                where += (where.empty() ? "" : ", ") + obj->name;
+            }
+            errors.push_back("Multiple definition of strong symbol: " + std::string(name) + " (" + where + ")");
+        }
+    }
+    if (!options.shared) {
+        for (const auto& name : order) {
+            const SymbolUse& use = uses.find(name)->second;
+            if (!use.defined && !shared_symbols.count(name) && !script_symbols.count(name)) {
+                errors.push_back("Undefined symbol: " + std::string(name) + " (referenced by " + use.first_ref->name + ")");
+            }
+        }
+    }
+    return errors;
+}
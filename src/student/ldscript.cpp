@@ -0,0 +1,278 @@
+#include "ldscript.hpp"
+#include <cctype>
+#include <fnmatch.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 词法单元：标点单独成词，其余连续的名字字符组成一个词
+std::vector<std::string> tokenize(const std::string& text)
+{
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    auto is_name_char = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '*'
+            || c == '?' || c == '$' || c == '[' || c == ']';
+    };
+
+    while (i < text.size()) {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+            size_t end = text.find("*/", i + 2);
+            if (end == std::string::npos) {
+                throw std::runtime_error("linker script: unterminated comment");
+            }
+            i = end + 2;
+        } else if (std::string("{}();=+-:,").find(c) != std::string::npos) {
+            tokens.emplace_back(1, c);
+            i++;
+        } else if (is_name_char(c)) {
+            size_t start = i;
+            while (i < text.size() && is_name_char(text[i])) {
+                i++;
+            }
+            tokens.push_back(text.substr(start, i - start));
+        } else {
+            throw std::runtime_error(std::string("linker script: unexpected character '") + c + "'");
+        }
+    }
+    return tokens;
+}
+
+class ScriptParser {
+public:
+    explicit ScriptParser(std::vector<std::string> tokens)
+        : tokens(std::move(tokens))
+    {
+    }
+
+    LinkerScript parse()
+    {
+        LinkerScript script;
+        while (!at_end()) {
+            if (peek() == "SECTIONS") {
+                next();
+                expect("{");
+                while (peek() != "}") {
+                    script.commands.push_back(parse_section_command());
+                }
+                expect("}");
+            } else {
+                // SECTIONS 之外只允许符号赋值
+                script.commands.push_back(parse_assignment());
+            }
+        }
+        return script;
+    }
+
+private:
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+
+    bool at_end() const { return pos >= tokens.size(); }
+
+    const std::string& peek() const
+    {
+        static const std::string eof;
+        return at_end() ? eof : tokens[pos];
+    }
+
+    std::string next()
+    {
+        if (at_end()) {
+            throw std::runtime_error("linker script: unexpected end of script");
+        }
+        return tokens[pos++];
+    }
+
+    void expect(const std::string& tok)
+    {
+        std::string got = next();
+        if (got != tok) {
+            throw std::runtime_error("linker script: expected '" + tok + "' but got '" + got + "'");
+        }
+    }
+
+    bool is_assignment() const
+    {
+        return pos + 1 < tokens.size() && tokens[pos + 1] == "=";
+    }
+
+    ScriptCommand parse_assignment()
+    {
+        ScriptCommand cmd;
+        std::string target = next();
+        expect("=");
+        cmd.kind = target == "." ? ScriptCommand::Kind::SetDot : ScriptCommand::Kind::Assign;
+        cmd.name = target;
+        cmd.expr = parse_expr();
+        expect(";");
+        return cmd;
+    }
+
+    ScriptCommand parse_section_command()
+    {
+        if (is_assignment()) {
+            return parse_assignment();
+        }
+
+        ScriptCommand cmd;
+        cmd.kind = ScriptCommand::Kind::OutputSection;
+        cmd.name = next();
+        if (peek() != ":") {
+            cmd.has_addr = true;
+            cmd.expr = parse_expr();
+        }
+        expect(":");
+        if (peek() == "ALIGN") {
+            next();
+            expect("(");
+            cmd.has_align = true;
+            cmd.align = parse_expr();
+            expect(")");
+        }
+        expect("{");
+        while (peek() != "}") {
+            if (is_assignment()) {
+                cmd.body.push_back(parse_assignment());
+            } else {
+                cmd.body.push_back(parse_input());
+            }
+        }
+        expect("}");
+        return cmd;
+    }
+
+    ScriptCommand parse_input()
+    {
+        ScriptCommand cmd;
+        cmd.kind = ScriptCommand::Kind::Input;
+        if (peek() == "KEEP") {
+            next();
+            expect("(");
+            cmd.keep = true;
+        }
+
+        std::string file_pattern = next();
+        if (file_pattern != "*") {
+            throw std::runtime_error("linker script: only '*' file patterns are supported, got '" + file_pattern + "'");
+        }
+        expect("(");
+        while (peek() != ")") {
+            std::string pattern = next();
+            if (pattern != ",") {
+                cmd.patterns.push_back(pattern);
+            }
+        }
+        expect(")");
+        if (cmd.patterns.empty()) {
+            throw std::runtime_error("linker script: empty input section list");
+        }
+
+        if (cmd.keep) {
+            expect(")");
+        }
+        if (peek() == ";") {
+            next();
+        }
+        return cmd;
+    }
+
+    ScriptExpr parse_expr()
+    {
+        ScriptExpr lhs = parse_term();
+        while (peek() == "+" || peek() == "-") {
+            ScriptExpr op;
+            op.kind = next() == "+" ? ScriptExpr::Kind::Add : ScriptExpr::Kind::Sub;
+            op.operands.push_back(std::move(lhs));
+            op.operands.push_back(parse_term());
+            lhs = std::move(op);
+        }
+        return lhs;
+    }
+
+    ScriptExpr parse_term()
+    {
+        ScriptExpr expr;
+        std::string tok = next();
+        if (tok == "(") {
+            expr = parse_expr();
+            expect(")");
+        } else if (tok == ".") {
+            expr.kind = ScriptExpr::Kind::Dot;
+        } else if (tok == "ALIGN") {
+            expect("(");
+            expr.kind = ScriptExpr::Kind::Align;
+            expr.operands.push_back(parse_expr());
+            expect(")");
+        } else if (std::isdigit(static_cast<unsigned char>(tok[0]))) {
+            expr.kind = ScriptExpr::Kind::Number;
+            expr.value = parse_number(tok);
+        } else {
+            expr.kind = ScriptExpr::Kind::Symbol;
+            expr.symbol = tok;
+        }
+        return expr;
+    }
+
+    static uint64_t parse_number(const std::string& tok)
+    {
+        size_t idx = 0;
+        uint64_t value;
+        try {
+            value = std::stoull(tok, &idx, 0);
+        } catch (const std::exception&) {
+            throw std::runtime_error("linker script: invalid number '" + tok + "'");
+        }
+        std::string suffix = tok.substr(idx);
+        if (suffix == "K") {
+            value <<= 10;
+        } else if (suffix == "M") {
+            value <<= 20;
+        } else if (!suffix.empty()) {
+            throw std::runtime_error("linker script: invalid number '" + tok + "'");
+        }
+        return value;
+    }
+};
+
+} // namespace
+
+LinkerScript parse_linker_script(const std::string& text)
+{
+    return ScriptParser(tokenize(text)).parse();
+}
+
+uint64_t eval_script_expr(const ScriptExpr& expr, uint64_t dot,
+    const std::function<uint64_t(const std::string&)>& lookup)
+{
+    switch (expr.kind) {
+    case ScriptExpr::Kind::Number:
+        return expr.value;
+    case ScriptExpr::Kind::Dot:
+        return dot;
+    case ScriptExpr::Kind::Symbol:
+        return lookup(expr.symbol);
+    case ScriptExpr::Kind::Align: {
+        uint64_t alignment = eval_script_expr(expr.operands[0], dot, lookup);
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            throw std::runtime_error("linker script: ALIGN requires a power of two");
+        }
+        return (dot + alignment - 1) & ~(alignment - 1);
+    }
+    case ScriptExpr::Kind::Add:
+        return eval_script_expr(expr.operands[0], dot, lookup) + eval_script_expr(expr.operands[1], dot, lookup);
+    case ScriptExpr::Kind::Sub:
+        return eval_script_expr(expr.operands[0], dot, lookup) - eval_script_expr(expr.operands[1], dot, lookup);
+    }
+    throw std::runtime_error("linker script: invalid expression");
+}
+
+bool script_pattern_match(const std::string& pattern, const std::string& name)
+{
+    return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+}
@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <iostream>
 #include <algorithm>
+#include <stdexcept>
 
 void FLE_nm(const FLEObject& obj)
 {
@@ -42,8 +43,8 @@ void FLE_nm(const FLEObject& obj)
             
             // 判断节类型
             bool is_text = (sec.find(".text") == 0);
-            bool is_data = (sec.find(".data") == 0);
-            bool is_bss = (sec.find(".bss") == 0);
+            bool is_data = (sec.find(".data") == 0 || sec.find(".tdata") == 0);
+            bool is_bss = (sec.find(".bss") == 0 || sec.find(".tbss") == 0);
             bool is_rodata = (sec.find(".rodata") == 0);
             
             // 决定基础类型字符
@@ -76,4 +77,26 @@ void FLE_nm(const FLEObject& obj)
         std::cout << std::hex << std::setfill('0') << std::setw(16) 
                   << address << " " << type_char << " " << sym.name << std::endl;
     }
-}
\ No newline at end of file
+}
+
+void FLE_nm_lookup(const FLEObject& obj, const std::vector<uint64_t>& addrs)
+{
+    if (obj.symbol_index.entries.empty()) {
+        throw std::runtime_error("nm: " + obj.name + " has no symbol index (only linked .exe and .so files have one)");
+    }
+    
+    // 每个地址在按地址排序的索引上二分查找，无需遍历符号表
+    for (uint64_t addr : addrs) {
+        std::cout << std::hex << std::setfill('0') << std::setw(16) << addr << " ";
+        const SymbolIndexEntry* entry = obj.symbol_index.lookup(addr);
+        if (entry == nullptr) {
+            std::cout << "??" << std::endl;
+            continue;
+        }
+        std::cout << obj.symbol_index.names[entry->name];
+        if (addr != entry->start) {
+            std::cout << "+0x" << (addr - entry->start);
+        }
+        std::cout << std::endl;
+    }
+}
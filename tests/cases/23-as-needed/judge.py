@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""
+验证 --as-needed
+- needed 字段应包含 libused.so
+- needed 字段不应包含未被引用的 libunused.so
+"""
+import json
+import sys
+import os
+
+
+def load_fle_json(path):
+    with open(path, 'r') as f:
+        return json.load(f)
+
+
+def judge():
+    try:
+        input_data = json.load(sys.stdin)
+        test_dir = input_data["test_dir"]
+        build_dir = os.path.join(test_dir, "build")
+
+        try:
+            exe_fle = load_fle_json(os.path.join(build_dir, "program"))
+        except Exception as e:
+            print(json.dumps({"success": False, "message": f"Failed to load executable: {str(e)}"}))
+            return
+
+        needed = exe_fle.get("needed", [])
+        if not any("libused" in dep for dep in needed):
+            print(json.dumps({"success": False, "message": f"libused.so not in needed list: {needed}"}))
+            return
+
+        if any("libunused" in dep for dep in needed):
+            print(json.dumps({"success": False, "message": f"libunused.so should have been dropped: {needed}"}))
+            return
+
+        print(json.dumps({"success": True, "message": f"As-needed verification passed. needed: {needed}"}))
+
+    except Exception as e:
+        print(json.dumps({"success": False, "message": f"Judge error: {str(e)}"}))
+
+
+if __name__ == "__main__":
+    judge()
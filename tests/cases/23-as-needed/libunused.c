@@ -0,0 +1,4 @@
+int unused_func(int x)
+{
+    return x - 1;
+}
@@ -0,0 +1,4 @@
+int used_func(int x)
+{
+    return x * 3;
+}
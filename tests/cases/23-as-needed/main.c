@@ -0,0 +1,10 @@
+extern int used_func(int);
+
+int main()
+{
+    // used_func(4) = 4 * 3 = 12
+    if (used_func(4) == 12) {
+        return 0; // 成功
+    }
+    return 1; // 失败
+}
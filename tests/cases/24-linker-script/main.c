@@ -0,0 +1,43 @@
+// 由链接脚本定义的符号
+extern char __hot_start[];
+extern char __hot_end[];
+extern char __data_start[];
+
+__attribute__((section(".text.hot"), noinline)) int hot_add(int a, int b)
+{
+    return a + b;
+}
+
+__attribute__((noinline)) int cold_double(int x)
+{
+    return x * 2;
+}
+
+int counter = 5;
+
+// 阻止编译器假定不同符号的地址一定不同
+static unsigned long addr_of(const void* p)
+{
+    unsigned long v = (unsigned long)p;
+    __asm__("" : "+r"(v));
+    return v;
+}
+
+int main(void)
+{
+    // .text.hot 被放在 .text 的最前面
+    if (addr_of(hot_add) != addr_of(__hot_start)) {
+        return 1;
+    }
+    if (addr_of(__hot_end) <= addr_of(__hot_start) || addr_of(cold_double) < addr_of(__hot_end)) {
+        return 2;
+    }
+    // .data 被放到脚本指定的地址
+    if (addr_of(&counter) != addr_of(__data_start) || addr_of(&counter) != 0x800000) {
+        return 3;
+    }
+    if (hot_add(counter, cold_double(1)) != 7) {
+        return 4;
+    }
+    return 0;
+}
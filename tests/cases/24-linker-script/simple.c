@@ -0,0 +1,6 @@
+int value = 42;
+
+int main(void)
+{
+    return value == 42 ? 0 : 1;
+}
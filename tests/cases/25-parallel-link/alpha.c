@@ -0,0 +1,11 @@
+int shared_value = 100;
+
+__attribute__((weak)) int pick(void)
+{
+    return 2;
+}
+
+int alpha(int x)
+{
+    return x + 1;
+}
@@ -0,0 +1,9 @@
+int pick(void)
+{
+    return 7;
+}
+
+int beta(int x)
+{
+    return x * x;
+}
@@ -0,0 +1,17 @@
+extern int alpha(int);
+extern int beta(int);
+extern int shared_value;
+
+__attribute__((weak)) int pick(void)
+{
+    return 1;
+}
+
+int main(void)
+{
+    // alpha(2) = 3, beta(3) = 9, pick() 由 beta.c 中的强定义提供 = 7
+    if (alpha(2) + beta(3) + pick() + shared_value == 3 + 9 + 7 + 100) {
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,9 @@
+int missing_value(void)
+{
+    return 41;
+}
+
+void missing_report(int value)
+{
+    (void)value;
+}
@@ -0,0 +1,12 @@
+#include "minilibc.h"
+
+int counter = 1;
+
+extern int missing_value(void);
+extern void missing_report(int);
+
+int main(void)
+{
+    missing_report(missing_value() + counter);
+    return 0;
+}
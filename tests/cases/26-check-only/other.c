@@ -0,0 +1,6 @@
+int counter = 2;
+
+int bump(void)
+{
+    return ++counter;
+}
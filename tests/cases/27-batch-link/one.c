@@ -0,0 +1,9 @@
+#include "minilibc.h"
+
+extern int square(int);
+
+int main(void)
+{
+    printf("one: %d\n", square(6));
+    return 0;
+}
@@ -0,0 +1,9 @@
+#include "minilibc.h"
+
+extern int square(int);
+
+int main(void)
+{
+    printf("two: %d\n", square(7) + 1);
+    return 0;
+}
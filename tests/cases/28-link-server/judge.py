@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+验证 ld --server / --connect
+- 通过服务器链接的结果与直接链接完全相同，且可以运行
+- 第二次链接时所有输入都来自服务器的缓存
+- 输入文件改变后重新解析
+- 套接字只有属主可以访问，已有的普通文件不会被删除
+- 缓存的条目数有上限，超出时淘汰最久未使用的输入
+"""
+import json
+import os
+import subprocess
+import sys
+import time
+
+
+def result(success, message):
+    print(json.dumps({"success": success, "message": message}))
+
+
+def judge():
+    input_data = json.load(sys.stdin)
+    test_dir = input_data["test_dir"]
+    root_dir = os.path.abspath(os.path.join(test_dir, "..", "..", ".."))
+    ld = os.path.join(root_dir, "ld")
+    exec_tool = os.path.join(root_dir, "exec")
+    socket_path = "build/ld.sock"
+    inputs = ["build/main.fo", "build/scale.fo", "../../common/minilibc.fo"]
+
+    def run(args):
+        return subprocess.run(args, cwd=test_dir, capture_output=True, text=True, timeout=10)
+
+    # 套接字路径上的普通文件必须保留
+    victim = os.path.join(test_dir, "build/not-a-socket")
+    with open(victim, "w") as f:
+        f.write("keep me\n")
+    proc = run([ld, "--server", "build/not-a-socket"])
+    if proc.returncode == 0 or "is not a socket" not in proc.stderr or not os.path.exists(victim):
+        return result(False, f"regular file at the socket path was not protected: {proc.stderr!r}")
+
+    # 上次运行留下的套接字会让下面的等待提前结束
+    if os.path.exists(os.path.join(test_dir, socket_path)):
+        os.unlink(os.path.join(test_dir, socket_path))
+    server = subprocess.Popen([ld, "--server", socket_path], cwd=test_dir,
+                              stderr=subprocess.PIPE, text=True)
+    try:
+        for _ in range(100):
+            if os.path.exists(os.path.join(test_dir, socket_path)):
+                break
+            time.sleep(0.02)
+        else:
+            return result(False, "server did not create its socket")
+        mode = os.stat(os.path.join(test_dir, socket_path)).st_mode & 0o777
+        if mode != 0o600:
+            return result(False, f"socket is accessible to other users: mode {mode:o}")
+
+        for name in ["first", "second"]:
+            proc = run([ld, "--connect", socket_path] + inputs + ["-o", "build/" + name])
+            if proc.returncode != 0:
+                return result(False, f"{name} link through server failed: {proc.stderr}")
+
+        # 更新输入文件的修改时间，服务器应重新解析它
+        os.utime(os.path.join(test_dir, "build/scale.fo"))
+        proc = run([ld, "--connect", socket_path] + inputs + ["-o", "build/third"])
+        if proc.returncode != 0:
+            return result(False, f"third link through server failed: {proc.stderr}")
+
+        proc = run([ld, "--connect", socket_path, "build/main.fo", "-o", "build/broken"])
+        if proc.returncode == 0 or "Undefined symbol: scale" not in proc.stderr:
+            return result(False, f"error was not forwarded to the client: {proc.stderr!r}")
+
+        run([ld, "--connect", socket_path, "--stop-server"])
+        _, server_log = server.communicate(timeout=10)
+    finally:
+        if server.poll() is None:
+            server.kill()
+
+    proc = run([ld] + inputs + ["-o", "build/direct"])
+    if proc.returncode != 0:
+        return result(False, f"direct link failed: {proc.stderr}")
+    for name in ["first", "second", "third"]:
+        with open(os.path.join(test_dir, "build", name)) as a, open(os.path.join(test_dir, "build/direct")) as b:
+            if a.read() != b.read():
+                return result(False, f"{name} differs from a direct link")
+
+    proc = run([exec_tool, "build/second"])
+    if proc.returncode != 0 or proc.stdout.strip() != "scaled: 42":
+        return result(False, f"program output {proc.stdout!r}")
+
+    lines = [l for l in server_log.splitlines() if l.startswith("ld: server: build/")]
+    expected = ["0 cached, 3 loaded", "3 cached, 0 loaded", "2 cached, 1 loaded"]
+    for line, want in zip(lines, expected):
+        if want not in line:
+            return result(False, f"unexpected cache use: {line!r}, expected {want!r}")
+    if len(lines) < len(expected):
+        return result(False, f"missing server log lines: {server_log!r}")
+
+    # 只缓存两个输入：第二个请求用到的正是最近使用的两个；
+    # 第三个请求从最久未使用的输入开始，每次加载都淘汰下一个要用的输入
+    small_socket = "build/ld-small.sock"
+    if os.path.exists(os.path.join(test_dir, small_socket)):
+        os.unlink(os.path.join(test_dir, small_socket))
+    server = subprocess.Popen([ld, "--server", small_socket, "--server-cache-entries=2"], cwd=test_dir,
+                              stderr=subprocess.PIPE, text=True)
+    try:
+        for _ in range(100):
+            if os.path.exists(os.path.join(test_dir, small_socket)):
+                break
+            time.sleep(0.02)
+        else:
+            return result(False, "bounded server did not create its socket")
+        run([ld, "--connect", small_socket] + inputs + ["-o", "build/bounded1"])
+        run([ld, "--connect", small_socket, "--check-only"] + inputs[1:] + ["-o", "build/bounded2"])
+        run([ld, "--connect", small_socket] + inputs + ["-o", "build/bounded3"])
+        run([ld, "--connect", small_socket, "--stop-server"])
+        _, server_log = server.communicate(timeout=10)
+    finally:
+        if server.poll() is None:
+            server.kill()
+
+    lines = [l for l in server_log.splitlines() if l.startswith("ld: server: build/")]
+    expected = ["0 cached, 3 loaded", "2 cached, 0 loaded", "0 cached, 3 loaded"]
+    if len(lines) != len(expected) or any(want not in line for line, want in zip(lines, expected)):
+        return result(False, f"bounded cache: expected {expected}, got {lines}")
+
+    result(True, "Server links match direct links and reuse a bounded cache of inputs")
+
+
+if __name__ == "__main__":
+    try:
+        judge()
+    except Exception as e:
+        result(False, f"Judge error: {str(e)}")
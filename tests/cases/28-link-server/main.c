@@ -0,0 +1,9 @@
+#include "minilibc.h"
+
+extern int scale(int);
+
+int main(void)
+{
+    printf("scaled: %d\n", scale(14));
+    return 0;
+}
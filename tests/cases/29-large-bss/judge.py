@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""
+验证大 .bss 只记录大小
+- 可执行文件中 .bss 段的大小覆盖 64 MiB 数组
+- .bss 不包含任何字节，文件本身很小
+"""
+import json
+import os
+import sys
+
+
+def judge():
+    try:
+        input_data = json.load(sys.stdin)
+        path = os.path.join(input_data["test_dir"], "build", "program")
+        with open(path) as f:
+            content = f.read()
+        if content.startswith("#!"):
+            content = content[content.find("\n") + 1:]
+        exe = json.loads(content)
+
+        bss = [p for p in exe.get("phdrs", []) if p["name"] == ".bss"]
+        if not bss or bss[0]["size"] < (64 << 20):
+            print(json.dumps({"success": False, "message": f".bss segment too small: {bss}"}))
+            return
+        if any(line.startswith("🔢") for line in exe.get(".bss", [])):
+            print(json.dumps({"success": False, "message": ".bss contains materialized bytes"}))
+            return
+        if os.path.getsize(path) > (1 << 20):
+            print(json.dumps({"success": False, "message": f"executable is {os.path.getsize(path)} bytes"}))
+            return
+
+        print(json.dumps({"success": True, "message": f".bss is {bss[0]['size']} bytes with no stored data"}))
+    except Exception as e:
+        print(json.dumps({"success": False, "message": f"Judge error: {str(e)}"}))
+
+
+if __name__ == "__main__":
+    judge()
@@ -0,0 +1,15 @@
+#include "minilibc.h"
+
+#define BIG_SIZE (64 << 20)
+
+char big[BIG_SIZE];
+int counters[1024];
+
+int main(void)
+{
+    big[0] = 1;
+    big[BIG_SIZE - 1] = 2;
+    counters[1023] = big[0] + big[BIG_SIZE - 1] + big[BIG_SIZE / 2];
+    printf("sum: %d\n", counters[1023]);
+    return 0;
+}
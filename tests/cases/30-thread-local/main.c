@@ -0,0 +1,18 @@
+#include "minilibc.h"
+
+__thread int counter = 40;
+__thread long zeroed;
+__thread char name[8] = "tls";
+
+extern __thread int shared_total;
+extern int bump(int);
+
+int main(void)
+{
+    counter += 2;
+    zeroed = bump(5);
+    printf("counter=%d zeroed=%d ", counter, (int)zeroed);
+    print("name=", name, 0);
+    printf(" total=%d\n", shared_total);
+    return 0;
+}
@@ -0,0 +1,9 @@
+__thread int shared_total = 100;
+static __thread int calls;
+
+int bump(int n)
+{
+    calls++;
+    shared_total += n * calls;
+    return calls;
+}
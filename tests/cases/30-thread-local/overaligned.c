@@ -0,0 +1,4 @@
+// 64 字节对齐的线程局部变量超出了静态 TLS 块的对齐，链接时必须报错
+_Alignas(64) __thread int wide[4] = { 1 };
+
+int read_wide(void) { return wide[0]; }
@@ -0,0 +1,110 @@
+#include "minilibc.h"
+
+// Splits a fixed amount of work over 1, 2 and 4 threads and reports the
+// wall-clock time of each run on stderr; stdout only carries the checks.
+
+#define MAX_THREADS 4
+#define TOTAL_WORK 8000000
+
+__thread long partial = 1000; // Every thread must start from the template value
+__thread long scratch; // ... and from zero here
+
+mutex_t lock;
+cond_t start_cond;
+int started;
+long total;
+long finished;
+
+struct job {
+    long begin;
+    long end;
+};
+
+static long work(long i) { return (i * 2654435761L) % 1009; }
+
+static void* worker(void* arg)
+{
+    struct job* job = arg;
+
+    mutex_lock(&lock);
+    while (!started)
+        cond_wait(&start_cond, &lock);
+    mutex_unlock(&lock);
+
+    long sum = partial - 1000 + scratch;
+    for (long i = job->begin; i < job->end; i++)
+        sum += work(i);
+    partial = sum;
+
+    mutex_lock(&lock);
+    total += partial;
+    mutex_unlock(&lock);
+    atomic_fetch_add_long(&finished, 1);
+    return (void*)partial;
+}
+
+static long now_us(void)
+{
+    long ts[2];
+    syscall(SYS_clock_gettime, 1 /* CLOCK_MONOTONIC */, ts);
+    return ts[0] * 1000000 + ts[1] / 1000;
+}
+
+static long run(int num_threads)
+{
+    thread_t threads[MAX_THREADS];
+    struct job jobs[MAX_THREADS];
+
+    total = 0;
+    started = 0;
+    atomic_store_long(&finished, 0);
+    for (int t = 0; t < num_threads; t++) {
+        jobs[t].begin = (long)TOTAL_WORK * t / num_threads;
+        jobs[t].end = (long)TOTAL_WORK * (t + 1) / num_threads;
+        if (thread_create(&threads[t], worker, &jobs[t]) != 0) {
+            print("thread_create failed\n", 0);
+            return -1;
+        }
+    }
+
+    long begin = now_us();
+    mutex_lock(&lock);
+    started = 1;
+    cond_broadcast(&start_cond);
+    mutex_unlock(&lock);
+
+    long joined = 0;
+    for (int t = 0; t < num_threads; t++) {
+        void* result;
+        thread_join(threads[t], &result);
+        joined += (long)result;
+    }
+    long elapsed = now_us() - begin;
+
+    char buf[64];
+    int len = sprintf(buf, "threads=%d time=%dus\n", num_threads, (int)elapsed);
+    syscall(SYS_write, 2, buf, len);
+
+    if (joined != total || atomic_load_long(&finished) != num_threads)
+        return -1;
+    return total;
+}
+
+int main(void)
+{
+    partial = 5; // Must not leak into the threads
+
+    long expected = 0;
+    for (long i = 0; i < TOTAL_WORK; i++)
+        expected += work(i);
+
+    for (int n = 1; n <= MAX_THREADS; n *= 2) {
+        long got = run(n);
+        printf("threads=%d ", n);
+        print(got == expected ? "ok\n" : "mismatch\n", 0);
+        if (got != expected)
+            return 1;
+    }
+    printf("main partial=%d\n", (int)partial);
+    return 0;
+}
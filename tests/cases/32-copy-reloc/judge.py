@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""
+验证复制重定位
+- 可执行文件对共享库变量各有一条 .dyncopy，且不再有针对它们的其他动态重定位
+- 共享库内对这些变量的引用经由 GOT 项（.dynabs64），从而绑定到可执行文件中的副本
+"""
+import json
+import os
+import sys
+
+SCRIPT_DIR = os.path.dirname(__file__)
+ROOT_DIR = os.path.abspath(os.path.join(SCRIPT_DIR, "..", ".."))
+if ROOT_DIR not in sys.path:
+    sys.path.append(ROOT_DIR)
+
+from common.fle_utils import extract_dynamic_relocs
+
+DATA_SYMBOLS = ["counter", "table", "greeting"]
+
+
+def load_fle_json(path):
+    with open(path) as f:
+        content = f.read()
+    if content.startswith("#!"):
+        content = content[content.find("\n") + 1:]
+    return json.loads(content)
+
+
+def judge():
+    try:
+        input_data = json.load(sys.stdin)
+        build_dir = os.path.join(input_data["test_dir"], "build")
+        exe_relocs = extract_dynamic_relocs(load_fle_json(os.path.join(build_dir, "program")))
+        lib_relocs = extract_dynamic_relocs(load_fle_json(os.path.join(build_dir, "libdata.so")))
+
+        for symbol in DATA_SYMBOLS:
+            kinds = [r["type"] for r in exe_relocs if r["symbol"] == symbol]
+            if kinds != [7]:
+                print(json.dumps({"success": False, "message": f"Expected one copy relocation for {symbol}, found types {kinds}"}))
+                return
+
+        for symbol in ["counter", "table"]:
+            got = [r for r in lib_relocs if r["symbol"] == symbol and r["type"] == 2]
+            if len(got) != 1:
+                print(json.dumps({"success": False, "message": f"Expected one GOT relocation for {symbol} in libdata.so, found {len(got)}"}))
+                return
+
+        print(json.dumps({"success": True, "message": f"{len(DATA_SYMBOLS)} variables copied into the executable"}))
+    except Exception as e:
+        print(json.dumps({"success": False, "message": f"Judge error: {str(e)}"}))
+
+
+if __name__ == "__main__":
+    judge()
@@ -0,0 +1,14 @@
+// Data exported by the library; the executable accesses it directly
+int counter = 7;
+int table[4] = { 1, 2, 3, 4 };
+char greeting[8] = "hello";
+
+int bump(void) { return ++counter; }
+
+int table_sum(void)
+{
+    int sum = 0;
+    for (int i = 0; i < 4; i++)
+        sum += table[i];
+    return sum;
+}
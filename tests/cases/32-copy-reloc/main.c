@@ -0,0 +1,23 @@
+#include "minilibc.h"
+
+extern int counter;
+extern int table[4];
+extern char greeting[8];
+extern int bump(void);
+extern int table_sum(void);
+
+int main(void)
+{
+    int sum = 0;
+    for (int i = 0; i < 4; i++)
+        sum += table[i];
+
+    // Writes through the copy must be visible to the library and back
+    counter += 10;
+    table[3] = 40;
+    int bumped = bump();
+
+    printf("counter=%d bumped=%d sum=%d lib_sum=%d ", counter, bumped, sum, table_sum());
+    print(greeting, "\n", 0);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""
+验证 GOT/PLT 去重与消除
+- 每个导入函数恰好一个 GOT 项，-fno-plt 与 PLT 调用共用
+- 可执行文件内定义的函数不占 GOT 项，也没有动态重定位
+- 只有经 call 调用的导入函数才有 PLT 项
+"""
+import json
+import os
+import sys
+
+SCRIPT_DIR = os.path.dirname(__file__)
+ROOT_DIR = os.path.abspath(os.path.join(SCRIPT_DIR, "..", ".."))
+if ROOT_DIR not in sys.path:
+    sys.path.append(ROOT_DIR)
+
+from common.fle_utils import extract_dynamic_relocs
+
+PLT_ENTRY_SIZE = 6
+
+
+def load_fle_json(path):
+    with open(path) as f:
+        content = f.read()
+    if content.startswith("#!"):
+        content = content[content.find("\n") + 1:]
+    return json.loads(content)
+
+
+def fail(message):
+    print(json.dumps({"success": False, "message": message}))
+
+
+def judge():
+    try:
+        input_data = json.load(sys.stdin)
+        exe = load_fle_json(os.path.join(input_data["test_dir"], "build", "program"))
+        relocs = extract_dynamic_relocs(exe)
+
+        got = sorted(r["symbol"] for r in relocs if r["section"] == ".got")
+        if got != ["negate", "triple"]:
+            return fail(f"Expected one GOT slot each for negate and triple, found {got}")
+        others = [r["symbol"] for r in relocs if r["section"] != ".got"]
+        if others:
+            return fail(f"Unexpected load-time relocations: {others}")
+
+        plt = [p for p in exe.get("phdrs", []) if p["name"] == ".plt"]
+        if not plt or plt[0]["size"] != 2 * PLT_ENTRY_SIZE:
+            return fail(f"Expected a .plt with 2 entries, found {plt}")
+        got_size = [p["size"] for p in exe.get("phdrs", []) if p["name"] == ".got"]
+        if got_size != [16]:
+            return fail(f"Expected a 16-byte .got, found {got_size}")
+
+        print(json.dumps({"success": True, "message": "2 GOT slots, 2 PLT entries, no other dynamic relocations"}))
+    except Exception as e:
+        fail(f"Judge error: {str(e)}")
+
+
+if __name__ == "__main__":
+    judge()
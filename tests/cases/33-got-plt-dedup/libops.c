@@ -0,0 +1,5 @@
+int scale = 3;
+
+int triple(int x) { return x * scale; }
+
+int negate(int x) { return -x; }
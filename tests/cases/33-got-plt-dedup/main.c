@@ -0,0 +1,16 @@
+#include "minilibc.h"
+
+// Built with -fno-plt: every call goes through *foo@GOTPCREL(%rip)
+extern int triple(int);
+extern int negate(int);
+extern int helper(int);
+extern int via_plt(int);
+
+int main(void)
+{
+    int a = triple(2); // Imported: shares its GOT slot with other.c
+    int b = helper(a); // Defined in the executable: relaxed to a direct call
+    int c = via_plt(b);
+    printf("a=%d b=%d c=%d\n", a, b, c);
+    return 0;
+}
@@ -0,0 +1,7 @@
+extern int triple(int);
+extern int negate(int);
+
+int helper(int x) { return x + 1; }
+
+// Built normally: calls to imported functions go through the PLT
+int via_plt(int x) { return negate(triple(x)); }
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+验证调用图排序
+- 热调用链 main -> a_hot_top -> c_hot_mid -> e_hot_leaf 紧密排在 .text 开头
+- 权重很低的 b_cold 不并入热簇，没有剖析数据的函数保持默认相对顺序
+- 不同线程数下输出完全相同
+- 热集合占用的页数少于默认布局（默认布局的页数随 minilibc 的大小变化，只比较大小）
+"""
+import json
+import os
+import re
+import subprocess
+import sys
+
+
+def load_fle_json(path):
+    with open(path) as f:
+        content = f.read()
+    if content.startswith("#!"):
+        content = content[content.find("\n") + 1:]
+    return json.loads(content)
+
+
+def fail(message):
+    print(json.dumps({"success": False, "message": message}))
+
+
+def judge():
+    try:
+        input_data = json.load(sys.stdin)
+        build_dir = os.path.join(input_data["test_dir"], "build")
+        exe = load_fle_json(os.path.join(build_dir, "program"))
+
+        symbols = []
+        for line in exe[".text"]:
+            if line.startswith("📤:"):
+                name, size, offset = line.split(":", 1)[1].split()
+                symbols.append((int(offset), int(size), name))
+        symbols.sort()
+        names = [name for _, _, name in symbols]
+
+        hot = ["main", "a_hot_top", "c_hot_mid", "e_hot_leaf"]
+        if names[:4] != hot:
+            return fail(f"Expected hot chain {hot} at the start of .text, found {names[:4]}")
+        hot_end = symbols[3][0] + symbols[3][1]
+        if hot_end > 4096:
+            return fail(f"Hot chain ends at offset {hot_end}, beyond the first page")
+        if names[4] != "b_cold":
+            return fail(f"Expected the lightly profiled b_cold after the hot chain, found {names[4]}")
+        if names.index("d_cold") > names.index("f_cold"):
+            return fail("Unprofiled functions d_cold and f_cold lost their default order")
+
+        with open(os.path.join(build_dir, "program"), "rb") as a, open(os.path.join(build_dir, "program2"), "rb") as b:
+            if a.read() != b.read():
+                return fail("Output differs between --threads=1 and --threads=4")
+
+        test_dir = input_data["test_dir"]
+        root_dir = os.path.abspath(os.path.join(test_dir, "..", "..", ".."))
+        proc = subprocess.run([os.path.join(root_dir, "ld"), "build/main.fo", "../../common/minilibc.fo",
+                               "--call-graph-profile=profile.txt", "-o", "build/program3"],
+                              cwd=test_dir, capture_output=True, text=True, timeout=30)
+        report = re.search(r"hot set (\d+) pages \(default layout (\d+) pages\)", proc.stderr)
+        if proc.returncode != 0 or report is None:
+            return fail(f"Missing hot set report: {proc.stderr!r}")
+        hot_pages, default_pages = int(report.group(1)), int(report.group(2))
+        if hot_pages >= default_pages:
+            return fail(f"Hot set spans {hot_pages} pages, not fewer than the default layout's {default_pages}")
+
+        print(json.dumps({"success": True, "message": f"hot chain packed into {hot_end} bytes, layout deterministic"}))
+    except Exception as e:
+        fail(f"Judge error: {str(e)}")
+
+
+if __name__ == "__main__":
+    judge()
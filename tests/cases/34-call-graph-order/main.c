@@ -0,0 +1,39 @@
+#include "minilibc.h"
+
+// 每个冷函数展开成约 2KB 的代码，默认布局下把热函数隔到不同的页上
+#define STEP(k) acc = acc * 31 + (k);
+#define STEP8(k) STEP(k) STEP(k + 1) STEP(k + 2) STEP(k + 3) STEP(k + 4) STEP(k + 5) STEP(k + 6) STEP(k + 7)
+#define STEP64(k) STEP8(k) STEP8(k + 8) STEP8(k + 16) STEP8(k + 24) STEP8(k + 32) STEP8(k + 40) STEP8(k + 48) STEP8(k + 56)
+#define COLD_BODY                    \
+    volatile long acc = x;           \
+    STEP64(0) STEP64(64) STEP64(128) \
+    return acc;
+
+long e_hot_leaf(long x);
+long c_hot_mid(long x);
+
+long a_hot_top(long n)
+{
+    long sum = 0;
+    for (long i = 0; i < n; i++) {
+        sum += c_hot_mid(i);
+    }
+    return sum;
+}
+
+long b_cold(long x) { COLD_BODY }
+
+long c_hot_mid(long x) { return e_hot_leaf(x) + e_hot_leaf(x + 1); }
+
+long d_cold(long x) { COLD_BODY }
+
+long e_hot_leaf(long x) { return x * 2; }
+
+long f_cold(long x) { COLD_BODY }
+
+int main(void)
+{
+    long cold = b_cold(1) + d_cold(2) + f_cold(3);
+    printf("sum=%d cold=%d\n", (int)a_hot_top(10), (int)(cold != 0));
+    return 0;
+}
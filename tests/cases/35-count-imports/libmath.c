@@ -0,0 +1,5 @@
+long square(long x) { return x * x; }
+
+long cube(long x) { return x * square(x); }
+
+long never_called(long x) { return -x; }
@@ -0,0 +1,37 @@
+#include "minilibc.h"
+
+// 4 个线程各调用 square 1000 次，主线程调用 cube 3 次；
+// 计数桩使用原子加，计数必须精确
+#define THREADS 4
+#define CALLS 1000
+
+long square(long x);
+long cube(long x);
+long never_called(long x);
+
+long (*volatile keep)(long) = never_called;
+
+static void* worker(void* arg)
+{
+    long sum = 0;
+    for (long i = 0; i < CALLS; i++)
+        sum += square(i % 7);
+    return (void*)sum;
+}
+
+int main(void)
+{
+    thread_t threads[THREADS];
+    long total = 0;
+    for (int i = 0; i < THREADS; i++)
+        thread_create(&threads[i], worker, 0);
+    for (int i = 0; i < THREADS; i++) {
+        void* result;
+        thread_join(threads[i], &result);
+        total += (long)result;
+    }
+    for (long i = 1; i <= 3; i++)
+        total += cube(i);
+    printf("total=%d\n", (int)total);
+    return 3;
+}
@@ -0,0 +1,9 @@
+#include "minilibc.h"
+
+int scale(int x);
+
+int main(void)
+{
+    printf("scaled=%d\n", scale(14));
+    return 0;
+}
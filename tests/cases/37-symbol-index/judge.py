@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+验证按地址排序的符号索引
+- 条目按地址排序，名字编号有效，每个导出符号都在索引中且地址、大小一致
+- 不含标签（以 . 开头）
+- nm <program> <addr> 通过索引把地址还原为 符号+偏移
+"""
+import json
+import os
+import subprocess
+import sys
+
+SCRIPT_DIR = os.path.dirname(__file__)
+ROOT_DIR = os.path.abspath(os.path.join(SCRIPT_DIR, "..", "..", ".."))
+
+
+def load_fle_json(path):
+    with open(path) as f:
+        content = f.read()
+    if content.startswith("#!"):
+        content = content[content.find("\n") + 1:]
+    return json.loads(content)
+
+
+def fail(message):
+    print(json.dumps({"success": False, "message": message}))
+
+
+def judge():
+    try:
+        input_data = json.load(sys.stdin)
+        program = os.path.join(input_data["test_dir"], "build", "program")
+        exe = load_fle_json(program)
+
+        index = exe.get("symbol_index")
+        if not index:
+            return fail("No symbol_index in the linked executable")
+        names = index["names"]
+        entries = [(start, size, names[name_id]) for start, size, name_id in index["entries"]]
+        if [(s, n) for s, _, n in entries] != sorted((s, n) for s, _, n in entries):
+            return fail("symbol_index entries are not sorted by address")
+        if any(name.startswith(".") for name in names):
+            return fail("symbol_index contains local labels")
+
+        vaddrs = {p["name"]: p["vaddr"] for p in exe["phdrs"]}
+        expected = set()
+        for section, lines in exe.items():
+            if section not in vaddrs or not isinstance(lines, list):
+                continue
+            for line in lines:
+                if line.startswith("📤:"):
+                    name, size, offset = line.split(":", 1)[1].split()
+                    expected.add((vaddrs[section] + int(offset), int(size), name))
+        missing = expected - set(entries)
+        if missing:
+            return fail(f"Symbols missing from symbol_index: {sorted(missing)[:5]}")
+
+        by_name = {n: (s, size) for s, size, n in entries}
+        for name in ("main", "crash_here", "helper", "table"):
+            if name not in by_name:
+                return fail(f"{name} is not in symbol_index")
+        main_start, _ = by_name["main"]
+        table_start, table_size = by_name["table"]
+        if table_size != 256:
+            return fail(f"table should cover 256 bytes, covers {table_size}")
+
+        queries = [main_start, main_start + 5, table_start + 100]
+        result = subprocess.run([os.path.join(ROOT_DIR, "nm"), program] + [f"{a:x}" for a in queries],
+                                capture_output=True, text=True)
+        got = [line.split(None, 1)[1] for line in result.stdout.splitlines()]
+        want = ["main", "main+0x5", "table+0x64"]
+        if result.returncode != 0 or got != want:
+            return fail(f"nm lookup returned {got}, expected {want}: {result.stderr.strip()}")
+
+        print(json.dumps({"success": True, "message": f"{len(entries)} sorted entries, nm lookups resolved"}))
+    except Exception as e:
+        fail(f"Judge error: {str(e)}")
+
+
+if __name__ == "__main__":
+    judge()
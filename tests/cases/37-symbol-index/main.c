@@ -0,0 +1,20 @@
+#include "minilibc.h"
+
+int table[64] = { 1 };
+
+__attribute__((noinline)) static int helper(int x) { return x * 3 + table[x & 63]; }
+
+__attribute__((noinline)) void crash_here(int* p)
+{
+    *p = helper(*p);
+}
+
+int main(void)
+{
+    int value = 4;
+    crash_here(&value);
+    printf("value=%d\n", value);
+    int* volatile bad = 0;
+    crash_here(bad);
+    return 0;
+}
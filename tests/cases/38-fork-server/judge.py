@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+验证 exec --fork-server
+- 加载完成后在状态管道上报告 ready
+- 每个请求运行一次程序，每次都从干净的状态开始
+- 每次运行的退出状态和耗时都被报告
+- 控制管道关闭后服务器退出
+"""
+import json
+import os
+import subprocess
+import sys
+
+RUNS = 20
+
+
+def result(success, message):
+    print(json.dumps({"success": success, "message": message}))
+
+
+def judge():
+    input_data = json.load(sys.stdin)
+    test_dir = input_data["test_dir"]
+    root_dir = os.path.abspath(os.path.join(test_dir, "..", "..", ".."))
+    exec_tool = os.path.join(root_dir, "exec")
+
+    proc = subprocess.run([exec_tool, "--fork-server", "build/program"], cwd=test_dir,
+                          capture_output=True, text=True, timeout=10)
+    if proc.returncode == 0 or "must be open" not in proc.stderr:
+        return result(False, f"missing control pipes were not reported: {proc.stderr!r}")
+
+    ctl_r, ctl_w = os.pipe()
+    st_r, st_w = os.pipe()
+    os.dup2(ctl_r, 198)
+    os.dup2(st_w, 199)
+    os.close(ctl_r)
+    os.close(st_w)
+    try:
+        server = subprocess.Popen([exec_tool, "--fork-server", "build/program"], cwd=test_dir,
+                                  stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True,
+                                  pass_fds=(198, 199))
+    finally:
+        os.close(198)
+        os.close(199)
+
+    control = os.fdopen(ctl_w, "w", buffering=1)
+    status = os.fdopen(st_r, "r")
+    try:
+        ready = status.readline().split()
+        if len(ready) != 2 or ready[0] != "ready" or not ready[1].isdigit():
+            return result(False, f"unexpected handshake: {ready!r}")
+
+        pids = set()
+        for i in range(RUNS):
+            control.write("run\n")
+            fields = status.readline().split()
+            if len(fields) != 4 or fields[1:3] != ["exit", "41"] or not fields[3].isdigit():
+                return result(False, f"run {i}: unexpected status {fields!r}")
+            pids.add(fields[0])
+        if len(pids) != RUNS:
+            return result(False, "runs did not get their own processes")
+
+        control.close()
+        stdout, stderr = server.communicate(timeout=10)
+    finally:
+        if server.poll() is None:
+            server.kill()
+
+    if server.returncode != 0:
+        return result(False, f"server exited with {server.returncode}: {stderr}")
+    lines = stdout.splitlines()
+    if lines != ["run 1 scratch 1"] * RUNS:
+        return result(False, f"runs did not start from a clean state: {lines[:3]!r}")
+
+    result(True, f"{RUNS} runs served from one load")
+
+
+if __name__ == "__main__":
+    try:
+        judge()
+    except Exception as e:
+        result(False, f"Judge error: {str(e)}")
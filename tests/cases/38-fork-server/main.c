@@ -0,0 +1,15 @@
+#include "minilibc.h"
+
+// 每次运行都应从加载完成时的状态开始：
+// 上一次运行对 .data/.bss 的修改不能被下一次看到
+int runs = 0;
+static char scratch[1 << 16];
+
+int main(void)
+{
+    runs++;
+    for (int i = 0; i < (int)sizeof(scratch); i++)
+        scratch[i] += 1;
+    printf("run %d scratch %d\n", runs, (int)scratch[12345]);
+    return 40 + runs;
+}
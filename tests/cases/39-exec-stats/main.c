@@ -0,0 +1,15 @@
+#include "minilibc.h"
+
+// 写满 1 MiB 的 .bss，每次运行至少产生 256 次缺页
+char buffer[1 << 20];
+
+int main(void)
+{
+    int sum = 0;
+    for (int i = 0; i < (int)sizeof(buffer); i += 4096) {
+        buffer[i] = (char)(i >> 12);
+        sum += buffer[i];
+    }
+    printf("sum=%d\n", sum);
+    return 7;
+}
@@ -0,0 +1,3 @@
+long square(long x) { return x * x; }
+
+long cube(long x) { return x * square(x); }
@@ -0,0 +1,2 @@
+// 预加载后替换 libmath 的 square，包括 libmath 内部 cube 对它的调用
+long square(long x) { return x * x + 1000; }
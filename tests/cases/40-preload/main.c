@@ -0,0 +1,10 @@
+#include "minilibc.h"
+
+long square(long x);
+long cube(long x);
+
+int main(void)
+{
+    printf("square=%d cube=%d\n", (int)square(3), (int)cube(2));
+    return 0;
+}
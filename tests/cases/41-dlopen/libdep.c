@@ -0,0 +1 @@
+long dep_offset(void) { return 7; }
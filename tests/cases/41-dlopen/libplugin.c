@@ -0,0 +1,5 @@
+// 插件引用可执行文件中的 base 和依赖库 libdep.so 中的 dep_offset
+extern long base;
+long dep_offset(void);
+
+long plugin_scale(long x) { return x * base + dep_offset(); }
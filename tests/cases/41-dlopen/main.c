@@ -0,0 +1,39 @@
+#include "minilibc.h"
+
+// 启动时不加载插件；直到第一次使用才通过 __fle_dlopen 加载
+long base = 100;
+
+static void* worker(void* arg)
+{
+    // 其他线程同样可以调用加载器服务
+    long (*scale)(long) = __fle_dlsym(0, "plugin_scale");
+    return (void*)scale((long)arg);
+}
+
+int main(void)
+{
+    if (__fle_dlsym(0, "plugin_scale") == 0)
+        print("before: ", __fle_dlerror(), "\n", 0);
+
+    void* plugin = __fle_dlopen("libplugin.so");
+    if (plugin == 0) {
+        print("dlopen failed: ", __fle_dlerror(), "\n", 0);
+        return 1;
+    }
+    long (*scale)(long) = __fle_dlsym(plugin, "plugin_scale");
+    printf("scale(5)=%d\n", (int)scale(5));
+    printf("same handle=%d\n", __fle_dlopen("libplugin.so") == plugin);
+
+    thread_t thread;
+    void* result;
+    thread_create(&thread, worker, (void*)3);
+    thread_join(thread, &result);
+    printf("thread scale(3)=%d\n", (int)(long)result);
+
+    if (__fle_dlsym(plugin, "dep_offset") == 0)
+        print("lookup: ", __fle_dlerror(), "\n", 0);
+    printf("cleared=%d\n", __fle_dlerror() == 0);
+    if (__fle_dlopen("libmissing.so") == 0)
+        print("missing: ", __fle_dlerror(), "\n", 0);
+    return 0;
+}
@@ -0,0 +1,3 @@
+int counter = 5;
+
+int add(int a, int b) { return a + b; }
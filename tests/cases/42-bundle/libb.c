@@ -0,0 +1,5 @@
+// libb 依赖 liba：打包时两者都要按加载顺序收入
+int add(int a, int b);
+extern int counter;
+
+int scaled_sum(int a, int b) { return add(a, b) * counter; }
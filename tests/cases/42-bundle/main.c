@@ -0,0 +1,11 @@
+#include "minilibc.h"
+
+int scaled_sum(int a, int b);
+extern int counter;
+
+int main(void)
+{
+    counter = 10;
+    printf("scaled_sum=%d\n", scaled_sum(2, 3));
+    return 0;
+}
@@ -0,0 +1,9 @@
+#include "minilibc.h"
+
+int huge_first(int x);
+
+int main(void)
+{
+    printf("result=%d\n", huge_first(1));
+    return 0;
+}
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+验证加载器的地址空间规划
+- 第一个库紧挨着可执行文件的最高段之后（按页对齐）
+- 依赖库紧接在前一个库之后，中间没有空洞
+- 库从最低段开始映射，不为 vaddr 0 之前的空白预留空间
+"""
+import json
+import os
+import re
+import subprocess
+import sys
+
+PAGE = 4096
+
+
+def result(success, message):
+    print(json.dumps({"success": success, "message": message}))
+
+
+def load_fle(path):
+    with open(path) as f:
+        text = f.read()
+    if text.startswith("#!"):
+        text = text.split("\n", 1)[1]
+    return json.loads(text)
+
+
+def extent(obj):
+    """库各段覆盖的 vaddr 范围，按页对齐"""
+    segs = [p for p in obj["phdrs"] if p["size"] > 0]
+    first = min(p["vaddr"] for p in segs) & ~(PAGE - 1)
+    end = max(p["vaddr"] + p["size"] for p in segs)
+    return first, (end + PAGE - 1) & ~(PAGE - 1)
+
+
+def symbol_vaddr(obj, name):
+    index = obj["symbol_index"]
+    return index["entries"][index["names"].index(name)][0]
+
+
+def judge():
+    input_data = json.load(sys.stdin)
+    test_dir = input_data["test_dir"]
+    root_dir = os.path.abspath(os.path.join(test_dir, "..", "..", ".."))
+    build_dir = os.path.join(test_dir, "build")
+
+    env = dict(os.environ, FLE_LIBRARY_PATH=build_dir)
+    proc = subprocess.run([os.path.join(root_dir, "exec"), os.path.join(build_dir, "program")],
+                          capture_output=True, text=True, timeout=10, env=env)
+    if proc.returncode != 0:
+        return result(False, f"program failed: {proc.stderr!r}")
+    addrs = dict(re.findall(r"^(first|second)=(0x[0-9a-f]+)$", proc.stdout, re.MULTILINE))
+    if len(addrs) != 2:
+        return result(False, f"unexpected output: {proc.stdout!r}")
+
+    exe = load_fle(os.path.join(build_dir, "program"))
+    first = load_fle(os.path.join(build_dir, "libfirst.so"))
+    second = load_fle(os.path.join(build_dir, "libsecond.so"))
+
+    exe_end = max(p["vaddr"] + p["size"] for p in exe["phdrs"] if p["size"] > 0)
+    first_start = (exe_end + PAGE - 1) & ~(PAGE - 1)
+    first_lo, first_hi = extent(first)
+    second_start = first_start + first_hi - first_lo
+    second_lo, _ = extent(second)
+
+    expected = {
+        "first": first_start + symbol_vaddr(first, "first") - first_lo,
+        "second": second_start + symbol_vaddr(second, "second") - second_lo,
+    }
+    for name, addr in expected.items():
+        if int(addrs[name], 16) != addr:
+            return result(False, f"{name} loaded at {addrs[name]}, expected {addr:#x}")
+    return result(True, "libraries are packed right above the executable")
+
+
+if __name__ == "__main__":
+    judge()
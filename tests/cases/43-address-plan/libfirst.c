@@ -0,0 +1,4 @@
+int second(int x);
+
+// 跨库调用：libfirst.so 中留下指向 second 的 PC32 动态重定位
+int first(int x) { return second(x) + 1; }
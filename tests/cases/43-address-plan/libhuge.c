@@ -0,0 +1,6 @@
+// 3 GiB 的 .bss，加上对 libsecond.so 中数据的 PC32 引用，
+// 无法与其他模块保持在 ±2 GiB 之内
+char huge[3UL << 30];
+extern int table[];
+
+int huge_first(int x) { return huge[x] + table[x]; }
@@ -0,0 +1,3 @@
+int table[5000] = { 1 };
+
+int second(int x) { return table[x] + x; }
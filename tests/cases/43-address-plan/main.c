@@ -0,0 +1,12 @@
+#include "minilibc.h"
+
+int first(int x);
+int second(int x);
+
+int main(void)
+{
+    printf("first=%p\n", (void*)first);
+    printf("second=%p\n", (void*)second);
+    printf("result=%d\n", first(40));
+    return 0;
+}
@@ -0,0 +1,7 @@
+int value = 42;
+
+int main(void)
+{
+    // .data 按 64KB 对齐，value 是其中唯一的变量
+    return value == 42 && ((unsigned long)&value & 0xffff) == 0 ? 0 : 1;
+}
@@ -1,6 +1,9 @@
 // As if this is the implementation of libc.
 
 #include "minilibc.h"
+#include <linux/futex.h>
+#include <linux/mman.h>
+#include <linux/sched.h>
 #include <stdarg.h>
 #include <sys/syscall.h>
 
@@ -13,11 +16,13 @@ long syscall(int num, ...)
     register long a2 asm("rsi") = va_arg(ap, long);
     register long a3 asm("rdx") = va_arg(ap, long);
     register long a4 asm("r10") = va_arg(ap, long);
+    register long a5 asm("r8") = va_arg(ap, long);
+    register long a6 asm("r9") = va_arg(ap, long);
     va_end(ap);
     asm volatile("syscall"
         : "+r"(a0)
-        : "r"(a1), "r"(a2), "r"(a3), "r"(a4)
-        : "memory", "rcx", "r8", "r9", "r11");
+        : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a6)
+        : "memory", "rcx", "r11");
     return a0;
 }
 
@@ -144,7 +149,203 @@ int vsprintf(char* buf, const char* fmt, va_list ap)
     return p - buf;
 }
 
+long atomic_load_long(const long* p) { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+
+void atomic_store_long(long* p, long v) { __atomic_store_n(p, v, __ATOMIC_SEQ_CST); }
+
+long atomic_fetch_add_long(long* p, long v) { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+
+int atomic_cas_long(long* p, long* expected, long desired)
+{
+    return __atomic_compare_exchange_n(p, expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static void futex_wait(int* addr, int val, int op) { syscall(SYS_futex, addr, op, val, NULL); }
+
+static void futex_wake(int* addr, int count) { syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count); }
+
+// state: 0 空闲，1 已加锁，2 已加锁且可能有人在等
+void mutex_lock(mutex_t* m)
+{
+    int c = 0;
+    if (__atomic_compare_exchange_n(&m->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    if (c != 2)
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        futex_wait(&m->state, 2, FUTEX_WAIT_PRIVATE);
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void mutex_unlock(mutex_t* m)
+{
+    if (__atomic_exchange_n(&m->state, 0, __ATOMIC_RELEASE) == 2)
+        futex_wake(&m->state, 1);
+}
+
+// seq 每次 signal/broadcast 加一，等待者据此判断是否错过了唤醒
+void cond_wait(cond_t* c, mutex_t* m)
+{
+    int seq = __atomic_load_n(&c->seq, __ATOMIC_RELAXED);
+    mutex_unlock(m);
+    futex_wait(&c->seq, seq, FUTEX_WAIT_PRIVATE);
+    mutex_lock(m);
+}
+
+void cond_signal(cond_t* c)
+{
+    __atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+    futex_wake(&c->seq, 1);
+}
+
+void cond_broadcast(cond_t* c)
+{
+    __atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+    futex_wake(&c->seq, 0x7fffffff);
+}
+
+// exec 在线程指针处放置的 TCB，布局与 exec.cpp 中的 ThreadControlBlock 一致
+struct tcb {
+    unsigned long self;
+    unsigned long tls_image;
+    unsigned long tls_image_size;
+    unsigned long tls_block_size;
+    const struct loader_services* services;
+    unsigned long stack_guard;
+    unsigned long padding[2];
+};
+
+// exec 经 TCB 提供的加载器服务，布局与 exec.cpp 中的 LoaderServices 一致
+struct loader_services {
+    void* (*dlopen)(const char* name);
+    void* (*dlsym)(void* handle, const char* name);
+    const char* (*dlerror)(void);
+};
+
+static const struct loader_services* get_loader_services(void)
+{
+    struct tcb* self;
+    asm("mov %%fs:0, %0" : "=r"(self));
+    return self->services;
+}
+
+void* __fle_dlopen(const char* name)
+{
+    return get_loader_services()->dlopen(name);
+}
+
+void* __fle_dlsym(void* handle, const char* name)
+{
+    return get_loader_services()->dlsym(handle, name);
+}
+
+const char* __fle_dlerror(void)
+{
+    return get_loader_services()->dlerror();
+}
+
+#define THREAD_STACK_SIZE (256 * 1024)
+#define PAGE_SIZE 4096
+
+// 位于线程映射区的最低处，其上依次是栈、TLS 块和 TCB
+struct thread {
+    void* (*fn)(void*);
+    void* arg;
+    void* result;
+    int tid; // 线程退出时由内核清零并唤醒 (CLONE_CHILD_CLEARTID)
+    unsigned long map_size;
+};
+
+__attribute__((used, noreturn)) static void thread_start(struct thread* t)
+{
+    t->result = t->fn(t->arg);
+    for (;;)
+        syscall(SYS_exit, 0);
+}
+
+// 子线程在新栈上从栈顶弹出 struct thread* 并进入 thread_start，永不返回
+static long clone_thread(unsigned long flags, void* stack, int* tid, unsigned long tls)
+{
+    register long rax asm("rax") = SYS_clone;
+    register long rdi asm("rdi") = flags;
+    register long rsi asm("rsi") = (long)stack;
+    register long rdx asm("rdx") = (long)tid;
+    register long r10 asm("r10") = (long)tid;
+    register long r8 asm("r8") = tls;
+    asm volatile("syscall\n\t"
+                 "test %%rax, %%rax\n\t"
+                 "jnz 1f\n\t"
+                 "xor %%ebp, %%ebp\n\t"
+                 "pop %%rdi\n\t"
+                 "call thread_start\n\t"
+                 "hlt\n"
+                 "1:"
+        : "+r"(rax)
+        : "r"(rdi), "r"(rsi), "r"(rdx), "r"(r10), "r"(r8)
+        : "memory", "rcx", "r11");
+    return rax;
+}
+
+int thread_create(thread_t* thread, void* (*fn)(void*), void* arg)
+{
+    struct tcb* self;
+    asm("mov %%fs:0, %0" : "=r"(self));
+
+    unsigned long size = sizeof(struct thread) + THREAD_STACK_SIZE + self->tls_block_size + sizeof(struct tcb);
+    size = (size + PAGE_SIZE - 1) & ~(unsigned long)(PAGE_SIZE - 1);
+    long base = syscall(SYS_mmap, NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base < 0 && base > -4096)
+        return (int)base;
+
+    // TLS 块紧贴在 TCB 下方，布局与 exec 为初始线程建立的相同
+    unsigned long tp = base + size - sizeof(struct tcb);
+    char* block = (char*)(tp - self->tls_block_size);
+    const char* image = (const char*)self->tls_image;
+    for (unsigned long i = 0; i < self->tls_image_size; i++)
+        block[i] = image[i];
+    struct tcb* tcb = (struct tcb*)tp;
+    tcb->self = tp;
+    tcb->tls_image = self->tls_image;
+    tcb->tls_image_size = self->tls_image_size;
+    tcb->tls_block_size = self->tls_block_size;
+    tcb->services = self->services;
+    tcb->stack_guard = self->stack_guard;
+
+    struct thread* t = (struct thread*)base;
+    t->fn = fn;
+    t->arg = arg;
+    t->map_size = size;
+
+    // 栈顶 16 字节对齐，压入 t 后正好满足 ABI 在 call 之前的对齐要求
+    unsigned long* stack = (unsigned long*)((unsigned long)block & ~15UL);
+    *--stack = (unsigned long)t;
+
+    unsigned long flags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD
+        | CLONE_SYSVSEM | CLONE_SETTLS | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID;
+    long ret = clone_thread(flags, stack, &t->tid, tp);
+    if (ret < 0) {
+        syscall(SYS_munmap, base, size);
+        return (int)ret;
+    }
+    *thread = t;
+    return 0;
+}
+
+int thread_join(thread_t t, void** result)
+{
+    // 内核的 CLONE_CHILD_CLEARTID 唤醒不带 PRIVATE 标志
+    int tid;
+    while ((tid = __atomic_load_n(&t->tid, __ATOMIC_ACQUIRE)) != 0)
+        futex_wait(&t->tid, tid, FUTEX_WAIT);
+    if (result)
+        *result = t->result;
+    syscall(SYS_munmap, t, t->map_size);
+    return 0;
+}
+
 int main();
 
 // libc provides the "_start".
-void _start() { syscall(SYS_exit, main()); }
+// exit_group 结束整个进程，包括尚未 join 的线程
+void _start() { syscall(SYS_exit_group, main()); }
@@ -16,4 +16,36 @@ int sprintf(char* buf, const char* fmt, ...);
 int vsprintf(char* buf, const char* fmt, va_list ap);
 int printf(const char* fmt, ...);
 
+// Threads: each one gets an mmap'd stack and its own copy of the TLS template
+typedef struct thread* thread_t;
+int thread_create(thread_t* thread, void* (*fn)(void*), void* arg);
+int thread_join(thread_t thread, void** result);
+
+// Futex-based mutex and condition variable; zero-initialized means ready to use
+typedef struct {
+    int state;
+} mutex_t;
+void mutex_lock(mutex_t* m);
+void mutex_unlock(mutex_t* m);
+
+typedef struct {
+    int seq;
+} cond_t;
+void cond_wait(cond_t* c, mutex_t* m);
+void cond_signal(cond_t* c);
+void cond_broadcast(cond_t* c);
+
+// Sequentially consistent atomics
+long atomic_load_long(const long* p);
+void atomic_store_long(long* p, long v);
+long atomic_fetch_add_long(long* p, long v);
+int atomic_cas_long(long* p, long* expected, long desired);
+
+// Load a shared library at run time through exec; handles stay valid
+// until exit. A null handle makes __fle_dlsym search every loaded module.
+// Both return null on failure, and __fle_dlerror then says why.
+void* __fle_dlopen(const char* name);
+void* __fle_dlsym(void* handle, const char* name);
+const char* __fle_dlerror(void);
+
 #endif // __MINILIBC_H__